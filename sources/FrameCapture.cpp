@@ -0,0 +1,221 @@
+
+
+#include "FrameCapture.h"
+#include "GLState.h"
+#include "PngEncoder.h"
+#include "lodepng.h"
+#include <algorithm>
+#include <stdio.h>
+
+namespace fs = std::filesystem;
+
+
+/**
+ * @brief Starts the encoder threads. GL objects are created by the first
+ * capture(), on the thread that renders.
+ *
+ * @param directory Output directory; it is created if necessary.
+ * @param lossless Wait for an encoder instead of dropping frames.
+ * @param ringSize Number of pixel buffer objects, i.e. how many frames a
+ * readback may stay in flight.
+ * @param encoderCount Number of encoder threads, 0 to use all but one core.
+ * @param bufferCount Number of CPU frame buffers, which bounds the memory
+ * used by frames waiting for an encoder.
+ */
+FrameCapture::FrameCapture(fs::path directory, const bool lossless,
+                           const unsigned ringSize, unsigned encoderCount,
+                           const unsigned bufferCount)
+    : directory(std::move(directory)), ring(std::max(ringSize, 1u)),
+      lossless(lossless) {
+    std::error_code ec;
+    fs::create_directories(this->directory, ec);
+    if (encoderCount == 0)
+        encoderCount = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+    // frames are encoded in parallel already; split the rest of the cores
+    encoderThreads =
+        std::max(std::thread::hardware_concurrency() / encoderCount, 1u);
+    for (unsigned i = 0; i < std::max(bufferCount, 1u); ++i)
+        freeBuffers.push_back(std::make_unique<Pixels>());
+    for (unsigned i = 0; i < encoderCount; ++i)
+        workers.emplace_back([this] { encodeLoop(); });
+}
+
+
+FrameCapture::~FrameCapture() {
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+    }
+    jobReady.notify_all();
+    for (auto& worker : workers)
+        worker.join();
+}
+
+
+/**
+ * @brief Reads back the frame just rendered. Call after drawing and before
+ * swapping buffers, on the thread that owns the GL context.
+ *
+ * @param frameWidth Width of the framebuffer in pixels.
+ * @param frameHeight Height of the framebuffer in pixels.
+ */
+void FrameCapture::capture(const int frameWidth, const int frameHeight) {
+    if (frameWidth != width || frameHeight != height) {
+        // size changed: flush what is in flight and resize the ring
+        for (size_t i = 0; i < ring.size(); ++i)
+            collect(ring[(next + i) % ring.size()], true);
+        releaseSlots();
+        width = frameWidth;
+        height = frameHeight;
+    }
+    const GLsizeiptr frameSize = static_cast<GLsizeiptr>(width) * height * 4;
+
+    Slot& slot = ring[next];
+    next = (next + 1) % ring.size();
+    collect(slot, true); // issued ring.size() frames ago, normally complete
+
+    if (slot.buffer == 0) {
+        glGenBuffers(1, &slot.buffer);
+        GLState::instance().bindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+        glBufferData(GL_PIXEL_PACK_BUFFER, frameSize, nullptr,
+                     GL_STREAM_READ);
+    }
+    GLState::instance().bindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    GLState::instance().bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+
+/**
+ * @brief Moves the pixels of a completed readback to an encoder.
+ *
+ * @param slot The ring slot to collect.
+ * @param wait Whether to wait for the readback if it is still in flight.
+ */
+void FrameCapture::collect(Slot& slot, const bool wait) {
+    if (!slot.fence)
+        return;
+    const GLenum status = glClientWaitSync(
+        slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, wait ? GL_TIMEOUT_IGNORED : 0);
+    if (status == GL_TIMEOUT_EXPIRED)
+        return;
+    glDeleteSync(slot.fence);
+    slot.fence = nullptr;
+
+    std::unique_ptr<Pixels> pixels;
+    {
+        std::unique_lock lock(mutex);
+        if (lossless)
+            jobDone.wait(lock, [this] { return !freeBuffers.empty(); });
+        if (!freeBuffers.empty()) {
+            pixels = std::move(freeBuffers.back());
+            freeBuffers.pop_back();
+        }
+    }
+    if (!pixels) { // every buffer is queued: drop rather than stall
+        ++dropped;
+        return;
+    }
+
+    const size_t frameSize = static_cast<size_t>(width) * height * 4;
+    GLState::instance().bindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+    if (const void* mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0,
+                                              frameSize, GL_MAP_READ_BIT)) {
+        const auto* bytes = static_cast<const unsigned char*>(mapped);
+        pixels->assign(bytes, bytes + frameSize);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    GLState::instance().bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    {
+        std::lock_guard lock(mutex);
+        jobs.push_back({frameCount++, width, height, std::move(pixels)});
+    }
+    jobReady.notify_one();
+}
+
+
+/**
+ * @brief Encoder thread: flips and encodes queued frames until stopped.
+ */
+void FrameCapture::encodeLoop() {
+    const PngEncoder encoder(encoderThreads);
+    Pixels flipped;
+    while (true) {
+        Job job;
+        {
+            std::unique_lock lock(mutex);
+            jobReady.wait(lock, [this] { return stopping || !jobs.empty(); });
+            if (jobs.empty())
+                return;
+            job = std::move(jobs.front());
+            jobs.pop_front();
+            ++encoding;
+        }
+        const int w = job.width, h = job.height;
+
+        // OpenGL rows start at the bottom, PNG rows at the top
+        const size_t rowSize = static_cast<size_t>(w) * 4;
+        flipped.resize(job.pixels->size());
+        for (int y = 0; y < h; ++y)
+            std::copy_n(job.pixels->begin() + (h - 1 - y) * rowSize, rowSize,
+                        flipped.begin() + y * rowSize);
+        {
+            std::lock_guard lock(mutex);
+            freeBuffers.push_back(std::move(job.pixels));
+        }
+        jobDone.notify_all();
+
+        char name[32];
+        snprintf(name, sizeof(name), "frame_%06u.png", job.frame);
+        const std::string fileName = (directory / name).string();
+        const unsigned error = encoder.save(fileName, flipped.data(), w, h);
+        if (error)
+            printf("Capture: cannot write %s: %s\n", fileName.c_str(),
+                   lodepng_error_text(error));
+        {
+            std::lock_guard lock(mutex);
+            --encoding;
+        }
+        jobDone.notify_all();
+    }
+}
+
+
+/**
+ * @brief Deletes the pixel buffer objects and fences of the ring.
+ */
+void FrameCapture::releaseSlots() {
+    for (Slot& slot : ring) {
+        if (slot.fence)
+            glDeleteSync(slot.fence);
+        if (slot.buffer)
+            GLState::instance().deleteBuffers(1, &slot.buffer);
+        slot = Slot{};
+    }
+}
+
+
+/**
+ * @brief Collects every readback still in flight, waits for the encoders and
+ * releases the GL objects. Call on the rendering thread before the context is
+ * destroyed.
+ */
+void FrameCapture::finish() {
+    for (size_t i = 0; i < ring.size(); ++i)
+        collect(ring[(next + i) % ring.size()], true);
+    releaseSlots();
+    {
+        std::unique_lock lock(mutex);
+        jobDone.wait(lock, [this] {
+            return workers.empty() || (jobs.empty() && encoding == 0);
+        });
+    }
+    printf("Capture: %u frames written to %s", frameCount,
+           directory.string().c_str());
+    if (dropped > 0)
+        printf(", %u dropped", dropped);
+    printf("\n");
+}
@@ -0,0 +1,86 @@
+#ifndef FRAMECAPTURE_H
+#define FRAMECAPTURE_H
+
+
+#include <glad/glad.h>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+/**
+ * @class FrameCapture
+ * @brief Records the rendered frames as a numbered PNG sequence without
+ * stalling the GPU.
+ *
+ * Every call to capture() starts an asynchronous glReadPixels into one pixel
+ * buffer object of a small ring, guarded by a fence. The pixels of a frame
+ * are mapped only when its slot comes around again, a few frames later, when
+ * the transfer has long finished. The mapped pixels are copied into a CPU
+ * buffer and handed to a pool of encoder threads that flip the rows, encode
+ * them with PngEncoder and write the file.
+ *
+ * Memory stays bounded: there is a fixed number of CPU frame buffers. If the
+ * encoders fall behind and all of them are queued, new frames are dropped
+ * instead of slowing down rendering, and the number of dropped frames is
+ * reported by finish(). Frames are numbered when they are queued for
+ * encoding, so the sequence has no gaps that would stop a reader such as
+ * ffmpeg's image2; after a drop it simply skips ahead in time. In lossless
+ * mode, used for offline rendering, capture() waits for a free buffer
+ * instead.
+ */
+class FrameCapture {
+
+    using Pixels = std::vector<unsigned char>;
+
+    struct Slot {
+        GLuint buffer = 0;
+        GLsync fence = nullptr;
+    };
+
+    struct Job {
+        unsigned frame;
+        int width, height;
+        std::unique_ptr<Pixels> pixels;
+    };
+
+    std::filesystem::path directory;
+    int width = 0;
+    int height = 0;
+    std::vector<Slot> ring;
+    size_t next = 0;
+    unsigned frameCount = 0; // frames queued for encoding
+    unsigned dropped = 0;
+
+    std::mutex mutex;
+    std::condition_variable jobReady;
+    std::condition_variable jobDone;
+    std::deque<Job> jobs;
+    unsigned encoding = 0;
+    std::vector<std::unique_ptr<Pixels>> freeBuffers;
+    std::vector<std::thread> workers;
+    bool stopping = false;
+    bool lossless = false;
+    unsigned encoderThreads = 1; // PngEncoder threads per encoder
+
+    void collect(Slot& slot, bool wait);
+    void encodeLoop();
+    void releaseSlots();
+
+  public:
+    FrameCapture(std::filesystem::path directory, bool lossless = false,
+                 unsigned ringSize = 3, unsigned encoderCount = 0,
+                 unsigned bufferCount = 8);
+    FrameCapture(const FrameCapture&) = delete;
+    FrameCapture& operator=(const FrameCapture&) = delete;
+    ~FrameCapture();
+
+    void capture(int width, int height);
+    void finish();
+};
+
+#endif
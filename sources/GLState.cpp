@@ -0,0 +1,107 @@
+
+
+#include "GLState.h"
+#include <algorithm>
+
+
+/**
+ * @brief Returns the state of the context the framework renders with. It is
+ * never destroyed, since objects of a global application object still
+ * delete their GL names through it after main() returns.
+ */
+GLState& GLState::instance() {
+    static GLState& state = *new GLState;
+    return state;
+}
+
+
+GLState::GLState() { invalidate(); }
+
+
+/**
+ * @brief Forgets every remembered state, so the next call of each kind
+ * reaches GL. Call it after changing state with plain GL calls.
+ */
+void GLState::invalidate() {
+    program = vertexArray = UNKNOWN;
+    std::fill(std::begin(buffers), std::end(buffers), UNKNOWN);
+    for (GLuint(&unit)[TEXTURE_COUNT] : textures)
+        std::fill(std::begin(unit), std::end(unit), UNKNOWN);
+    activeUnit = UNKNOWN;
+    lineWidth = pointSize = -1.0f;
+    capabilities.clear();
+}
+
+
+std::size_t GLState::bufferIndex(GLenum target) {
+    return std::size_t(std::find(std::begin(BUFFER_TARGETS),
+                                 std::end(BUFFER_TARGETS), target) -
+                       std::begin(BUFFER_TARGETS));
+}
+
+
+std::size_t GLState::textureIndex(GLenum target) {
+    return std::size_t(std::find(std::begin(TEXTURE_TARGETS),
+                                 std::end(TEXTURE_TARGETS), target) -
+                       std::begin(TEXTURE_TARGETS));
+}
+
+
+void GLState::setCapability(GLenum capability, bool enabled) {
+    auto it = std::find_if(capabilities.begin(), capabilities.end(),
+                           [capability](const std::pair<GLenum, bool>& c) {
+                               return c.first == capability;
+                           });
+    if (it == capabilities.end()) {
+        capabilities.emplace_back(capability, !enabled);
+        it = capabilities.end() - 1;
+    }
+    if (!change(it->second, enabled))
+        return;
+    if (enabled)
+        glEnable(capability);
+    else
+        glDisable(capability);
+}
+
+
+/**
+ * @brief Deletes a program. GL keeps a program in use alive, so the current
+ * program is only forgotten.
+ */
+void GLState::deleteProgram(GLuint id) {
+    if (program == id)
+        program = UNKNOWN;
+    glDeleteProgram(id);
+}
+
+
+/**
+ * @brief Deletes vertex arrays; GL unbinds a deleted one, and so does the
+ * cache.
+ */
+void GLState::deleteVertexArrays(GLsizei count, const GLuint* ids) {
+    for (GLsizei i = 0; i < count; ++i)
+        if (ids[i] != 0 && vertexArray == ids[i])
+            vertexArray = 0;
+    glDeleteVertexArrays(count, ids);
+}
+
+
+void GLState::deleteBuffers(GLsizei count, const GLuint* ids) {
+    for (GLsizei i = 0; i < count; ++i)
+        for (GLuint& buffer : buffers)
+            if (ids[i] != 0 && buffer == ids[i])
+                buffer = 0;
+    glDeleteBuffers(count, ids);
+}
+
+
+void GLState::deleteTextures(GLsizei count, const GLuint* ids) {
+    for (GLsizei i = 0; i < count; ++i)
+        for (GLuint(&unit)[TEXTURE_COUNT] : textures)
+            for (GLuint& texture : unit)
+                if (ids[i] != 0 && texture == ids[i])
+                    texture = 0;
+    glDeleteTextures(count, ids);
+}
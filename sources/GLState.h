@@ -0,0 +1,163 @@
+#ifndef GLSTATE_H
+#define GLSTATE_H
+
+
+#include <glad/glad.h>
+#include <cstddef>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+
+/**
+ * @class GLState
+ * @brief Remembers the bindings and raster state of the GL context and drops
+ * calls that would set what is already set.
+ *
+ * The framework binds programs, vertex arrays, buffers and textures, and sets
+ * the line width, point size and enabled capabilities through this class
+ * instead of calling GL directly. A call that matches the remembered value
+ * is skipped; every other call is passed to GL and remembered. getIssued()
+ * and getSkipped() count both kinds.
+ *
+ * Objects must be deleted through deleteBuffers(), deleteVertexArrays(),
+ * deleteTextures() and deleteProgram() as well, since GL reuses the name of a
+ * deleted object and a stale binding would skip binding its successor. Code
+ * that changes these states with plain GL calls must call invalidate()
+ * afterwards. Element array buffers belong to the vertex array, so their
+ * binds are always passed on, and so are indexed binds through
+ * bindBufferBase(). Until a state is first set it is unknown, and setting it
+ * is never skipped.
+ *
+ * There is one instance, for the context the framework renders with; it must
+ * be used only by the thread the context is current on.
+ */
+class GLState {
+
+    static constexpr GLuint UNKNOWN = ~0u;
+    static constexpr unsigned TEXTURE_UNITS = 32;
+    static constexpr GLenum BUFFER_TARGETS[] = {
+        GL_ARRAY_BUFFER,       GL_PIXEL_PACK_BUFFER,
+        GL_PIXEL_UNPACK_BUFFER, GL_UNIFORM_BUFFER,
+        GL_SHADER_STORAGE_BUFFER, GL_DRAW_INDIRECT_BUFFER};
+    static constexpr GLenum TEXTURE_TARGETS[] = {GL_TEXTURE_2D,
+                                                 GL_TEXTURE_2D_ARRAY};
+    static constexpr std::size_t BUFFER_COUNT = std::size(BUFFER_TARGETS);
+    static constexpr std::size_t TEXTURE_COUNT = std::size(TEXTURE_TARGETS);
+
+    GLuint program = UNKNOWN;
+    GLuint vertexArray = UNKNOWN;
+    GLuint buffers[BUFFER_COUNT];
+    GLuint textures[TEXTURE_UNITS][TEXTURE_COUNT];
+    unsigned activeUnit = UNKNOWN;
+    float lineWidth = -1.0f, pointSize = -1.0f;
+    std::vector<std::pair<GLenum, bool>> capabilities;
+    std::size_t issued = 0, skipped = 0;
+
+    /**
+     * @brief Remembers value in slot and returns true if that changed it.
+     */
+    template <typename T>
+    bool change(T& slot, const T value) {
+        if (slot == value) {
+            ++skipped;
+            return false;
+        }
+        slot = value;
+        ++issued;
+        return true;
+    }
+
+    static std::size_t bufferIndex(GLenum target);
+    static std::size_t textureIndex(GLenum target);
+    void setCapability(GLenum capability, bool enabled);
+
+  public:
+    static GLState& instance();
+
+    GLState();
+    GLState(const GLState&) = delete;
+    GLState& operator=(const GLState&) = delete;
+
+    void invalidate();
+
+    void useProgram(GLuint id) {
+        if (change(program, id))
+            glUseProgram(id);
+    }
+
+    void bindVertexArray(GLuint id) {
+        if (change(vertexArray, id))
+            glBindVertexArray(id);
+    }
+
+    void bindBuffer(GLenum target, GLuint id) {
+        const std::size_t index = bufferIndex(target);
+        if (index == BUFFER_COUNT) { // not tracked
+            ++issued;
+            glBindBuffer(target, id);
+        } else if (change(buffers[index], id)) {
+            glBindBuffer(target, id);
+        }
+    }
+
+    // binds to an indexed binding point, which binds the generic one as well
+    void bindBufferBase(GLenum target, GLuint index, GLuint id) {
+        ++issued;
+        glBindBufferBase(target, index, id);
+        const std::size_t slot = bufferIndex(target);
+        if (slot < BUFFER_COUNT)
+            buffers[slot] = id;
+    }
+
+    void activeTexture(unsigned unit) {
+        if (change(activeUnit, unit))
+            glActiveTexture(GL_TEXTURE0 + unit);
+    }
+
+    // binds to the active texture unit
+    void bindTexture(GLenum target, GLuint id) {
+        const std::size_t index = textureIndex(target);
+        if (activeUnit >= TEXTURE_UNITS || index == TEXTURE_COUNT) {
+            ++issued;
+            glBindTexture(target, id);
+        } else if (change(textures[activeUnit][index], id)) {
+            glBindTexture(target, id);
+        }
+    }
+
+    void bindTexture(unsigned unit, GLenum target, GLuint id) {
+        const std::size_t index = textureIndex(target);
+        if (unit < TEXTURE_UNITS && index < TEXTURE_COUNT &&
+            textures[unit][index] == id) {
+            ++skipped; // no need to activate the unit either
+            return;
+        }
+        activeTexture(unit);
+        bindTexture(target, id);
+    }
+
+    void setLineWidth(float width) {
+        if (change(lineWidth, width))
+            glLineWidth(width);
+    }
+
+    void setPointSize(float size) {
+        if (change(pointSize, size))
+            glPointSize(size);
+    }
+
+    void enable(GLenum capability) { setCapability(capability, true); }
+    void disable(GLenum capability) { setCapability(capability, false); }
+
+    void deleteProgram(GLuint id);
+    void deleteVertexArrays(GLsizei count, const GLuint* ids);
+    void deleteBuffers(GLsizei count, const GLuint* ids);
+    void deleteTextures(GLsizei count, const GLuint* ids);
+
+    [[nodiscard]] std::size_t getIssued() const { return issued; }
+    [[nodiscard]] std::size_t getSkipped() const { return skipped; }
+    void resetCounters() { issued = skipped = 0; }
+};
+
+#endif
@@ -0,0 +1,165 @@
+
+
+#include "HeadlessContext.h"
+#include "PngEncoder.h"
+#include "lodepng.h"
+#include <glad/glad.h>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <algorithm>
+#include <stdio.h>
+#include <vector>
+
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#    define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+
+
+/**
+ * @brief Creates the EGL context and the offscreen framebuffer, and makes
+ * them current on the calling thread.
+ *
+ * @param major Requested OpenGL major version.
+ * @param minor Requested OpenGL minor version.
+ * @param width Width of the offscreen framebuffer in pixels.
+ * @param height Height of the offscreen framebuffer in pixels.
+ * @return True on success; on failure the reason is printed.
+ */
+bool HeadlessContext::create(const int major, const int minor,
+                             const int width, const int height) {
+    EGLDisplay dpy = EGL_NO_DISPLAY;
+    const auto getPlatformDisplay =
+        reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(
+            eglGetProcAddress("eglGetPlatformDisplayEXT"));
+    if (getPlatformDisplay)
+        dpy = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA,
+                                 EGL_DEFAULT_DISPLAY, nullptr);
+    if (dpy == EGL_NO_DISPLAY)
+        dpy = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+    EGLint eglMajor, eglMinor;
+    if (dpy == EGL_NO_DISPLAY || !eglInitialize(dpy, &eglMajor, &eglMinor)) {
+        printf("Headless: cannot initialize EGL display\n");
+        return false;
+    }
+    display = dpy;
+
+    if (!eglBindAPI(EGL_OPENGL_API)) {
+        printf("Headless: EGL has no desktop OpenGL support\n");
+        destroy();
+        return false;
+    }
+
+    const EGLint configAttribs[] = {EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+                                    EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+                                    EGL_NONE};
+    EGLConfig config = nullptr;
+    EGLint numConfigs = 0;
+    eglChooseConfig(dpy, configAttribs, &config, 1, &numConfigs);
+
+    const EGLint contextAttribs[] = {EGL_CONTEXT_MAJOR_VERSION,
+                                     major,
+                                     EGL_CONTEXT_MINOR_VERSION,
+                                     minor,
+                                     EGL_CONTEXT_OPENGL_PROFILE_MASK,
+                                     EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+                                     EGL_NONE};
+    // without a matching config rely on EGL_KHR_no_config_context
+    const EGLContext ctx =
+        eglCreateContext(dpy, numConfigs > 0 ? config : EGL_NO_CONFIG_KHR,
+                         EGL_NO_CONTEXT, contextAttribs);
+    if (ctx == EGL_NO_CONTEXT) {
+        printf("Headless: cannot create OpenGL %d.%d context\n", major,
+               minor);
+        destroy();
+        return false;
+    }
+    context = ctx;
+
+    if (!eglMakeCurrent(dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, ctx)) {
+        printf("Headless: surfaceless contexts are not supported\n");
+        destroy();
+        return false;
+    }
+    if (!gladLoadGLLoader(reinterpret_cast<GLADloadproc>(eglGetProcAddress))) {
+        printf("Headless: cannot load OpenGL functions\n");
+        destroy();
+        return false;
+    }
+
+    this->width = width;
+    this->height = height;
+    glGenRenderbuffers(1, &colorBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                              GL_RENDERBUFFER, colorBuffer);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        printf("Headless: offscreen framebuffer is incomplete\n");
+        destroy();
+        return false;
+    }
+    glViewport(0, 0, width, height);
+    printf("Headless: %s, %s\n", glGetString(GL_RENDERER),
+           glGetString(GL_VERSION));
+    return true;
+}
+
+
+/**
+ * @brief Releases the framebuffer, the context and the display.
+ */
+void HeadlessContext::destroy() {
+    if (context) {
+        glDeleteFramebuffers(1, &framebuffer);
+        glDeleteRenderbuffers(1, &colorBuffer);
+        framebuffer = colorBuffer = 0;
+        eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE,
+                       EGL_NO_CONTEXT);
+        eglDestroyContext(display, context);
+        context = nullptr;
+    }
+    if (display) {
+        eglTerminate(display);
+        display = nullptr;
+    }
+}
+
+
+/**
+ * @brief Binds the offscreen framebuffer, which stands in for the window.
+ */
+void HeadlessContext::bindFramebuffer() const {
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+}
+
+
+/**
+ * @brief Writes the content of the offscreen framebuffer to a PNG file.
+ *
+ * @param fileName The output file.
+ * @return True if the file was written.
+ */
+bool HeadlessContext::savePng(const std::string& fileName) const {
+    const size_t rowSize = static_cast<size_t>(width) * 4;
+    std::vector<unsigned char> pixels(rowSize * height);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE,
+                 pixels.data());
+
+    // OpenGL rows start at the bottom, PNG rows at the top
+    std::vector<unsigned char> image(pixels.size());
+    for (int y = 0; y < height; ++y)
+        std::copy_n(pixels.begin() + (height - 1 - y) * rowSize, rowSize,
+                    image.begin() + y * rowSize);
+
+    const unsigned error =
+        PngEncoder().save(fileName, image.data(), width, height);
+    if (error)
+        printf("Headless: cannot write %s: %s\n", fileName.c_str(),
+               lodepng_error_text(error));
+    return error == 0;
+}
@@ -0,0 +1,45 @@
+#ifndef HEADLESSCONTEXT_H
+#define HEADLESSCONTEXT_H
+
+
+#include <string>
+
+
+/**
+ * @class HeadlessContext
+ * @brief OpenGL context without a window, rendering into an offscreen
+ * framebuffer.
+ *
+ * The context is created through EGL on a surfaceless display
+ * (EGL_MESA_platform_surfaceless when available, the default display
+ * otherwise), so it works on render nodes without a display server and with
+ * Mesa's llvmpipe software rasterizer. A framebuffer object of the requested
+ * size with an RGBA8 color attachment is bound in place of the default
+ * framebuffer, so code drawing into "the window" needs no changes.
+ */
+class HeadlessContext {
+
+    void* display = nullptr;
+    void* context = nullptr;
+    unsigned int framebuffer = 0;
+    unsigned int colorBuffer = 0;
+    int width = 0;
+    int height = 0;
+
+  public:
+    HeadlessContext() = default;
+    HeadlessContext(const HeadlessContext&) = delete;
+    HeadlessContext& operator=(const HeadlessContext&) = delete;
+    ~HeadlessContext() { destroy(); }
+
+    bool create(int major, int minor, int width, int height);
+    void destroy();
+
+    void bindFramebuffer() const;
+    bool savePng(const std::string& fileName) const;
+
+    [[nodiscard]] int getWidth() const { return width; }
+    [[nodiscard]] int getHeight() const { return height; }
+};
+
+#endif
@@ -0,0 +1,182 @@
+
+
+#include "IndirectDrawList.h"
+#include <algorithm>
+
+
+namespace {
+
+constexpr GLuint GROUP_SIZE = 64;
+
+// one invocation per object; commands[i] is
+// {count, instanceCount, first, baseInstance}, the base instance being i
+// so that the object index attribute reads i
+const char* const cullingShaderSource = R"(
+    #version 430 core
+    layout(local_size_x = 64) in;
+
+    struct Object {
+        vec4 low, high;
+        uint first, count;
+    };
+    layout(std430, binding = 0) readonly buffer Objects {
+        Object objects[];
+    };
+    layout(std430, binding = 1) writeonly buffer Commands {
+        uvec4 commands[];
+    };
+    uniform mat4 view;
+    uniform int objectCount;
+
+    void main() {
+        const uint i = gl_GlobalInvocationID.x;
+        if (i >= uint(objectCount))
+            return;
+        const Object object = objects[i];
+        // how many corners are beyond x = -w, x = w, y = -w and y = w
+        vec4 beyond = vec4(0.0);
+        for (int corner = 0; corner < 8; ++corner) {
+            const vec3 pick =
+                vec3(corner & 1, (corner >> 1) & 1, (corner >> 2) & 1);
+            const vec4 p =
+                view * vec4(mix(object.low.xyz, object.high.xyz, pick), 1.0);
+            beyond += vec4(lessThan(vec4(p.x, -p.x, p.y, -p.y), vec4(-p.w)));
+        }
+        const bool visible = !any(equal(beyond, vec4(8.0)));
+        commands[i] =
+            uvec4(object.count, visible ? 1u : 0u, object.first, i);
+    }
+)";
+
+} // namespace
+
+
+IndirectDrawList::IndirectDrawList() {
+    culler.createCompute(cullingShaderSource);
+    glGenBuffers(1, &objectBuffer);
+    glGenBuffers(1, &commandBuffer);
+    glGenBuffers(1, &indexBuffer);
+    // attribute 1 advances once per instance, from the base instance
+    geometry.Bind();
+    GLState::instance().bindBuffer(GL_ARRAY_BUFFER, indexBuffer);
+    glEnableVertexAttribArray(1);
+    glVertexAttribIPointer(1, 1, GL_UNSIGNED_INT, 0, nullptr);
+    glVertexAttribDivisor(1, 1);
+}
+
+
+IndirectDrawList::~IndirectDrawList() {
+    GLState::instance().deleteBuffers(1, &objectBuffer);
+    GLState::instance().deleteBuffers(1, &commandBuffer);
+    GLState::instance().deleteBuffers(1, &indexBuffer);
+}
+
+
+/**
+ * @brief Appends an object. Its vertices reach the GPU at the next draw().
+ *
+ * @param vertices The vertices of the object, copied at once.
+ * @param count Number of vertices.
+ * @return Index of the object, its draw order in the list.
+ */
+std::size_t IndirectDrawList::add(const vec3* vertices, std::size_t count) {
+    std::vector<vec3>& vtx = geometry.Vtx();
+    Object object{};
+    object.first = (GLuint)vtx.size();
+    object.count = (GLuint)count;
+    if (count > 0) {
+        vec3 low = vertices[0], high = vertices[0];
+        for (std::size_t i = 1; i < count; ++i) {
+            low = min(low, vertices[i]);
+            high = max(high, vertices[i]);
+        }
+        object.low = vec4(low, 1);
+        object.high = vec4(high, 1);
+    }
+    vtx.insert(vtx.end(), vertices, vertices + count);
+    objects.push_back(object);
+    dirty = true;
+    return objects.size() - 1;
+}
+
+
+/**
+ * @brief Removes every object; the GPU buffers are kept for reuse.
+ */
+void IndirectDrawList::clear() {
+    geometry.Vtx().clear();
+    objects.clear();
+    dirty = true;
+}
+
+
+/**
+ * @brief Sends the vertices and the objects to the GPU, growing the command
+ * and index buffers when there are more objects than they hold.
+ */
+void IndirectDrawList::upload() {
+    dirty = false;
+    if (objects.empty())
+        return;
+    geometry.updateGPU();
+    GLState& state = GLState::instance();
+    state.bindBuffer(GL_SHADER_STORAGE_BUFFER, objectBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, objects.size() * sizeof(Object),
+                 objects.data(), GL_DYNAMIC_DRAW);
+    if (objects.size() > capacity) {
+        capacity = std::max(objects.size(), capacity * 2);
+        state.bindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+        glBufferData(GL_DRAW_INDIRECT_BUFFER, capacity * 4 * sizeof(GLuint),
+                     nullptr, GL_DYNAMIC_COPY);
+        std::vector<GLuint> indices(capacity);
+        for (std::size_t i = 0; i < capacity; ++i)
+            indices[i] = (GLuint)i;
+        state.bindBuffer(GL_ARRAY_BUFFER, indexBuffer);
+        glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(GLuint),
+                     indices.data(), GL_STATIC_DRAW);
+    }
+}
+
+
+/**
+ * @brief Culls the objects against the viewport and draws the rest.
+ *
+ * @param prog Program to draw with, its uniforms already set.
+ * @param type Primitive type of every object, e.g. GL_LINES.
+ * @param view The transform the vertex shader applies to the vertices
+ * before the viewport, used for culling.
+ */
+void IndirectDrawList::draw(GPUProgram* prog, int type, const mat4& view) {
+    if (dirty)
+        upload();
+    if (objects.empty())
+        return;
+
+    GLState& state = GLState::instance();
+    culler.Use();
+    culler.setUniform(view, "view");
+    culler.setUniform((int)objects.size(), "objectCount");
+    state.bindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, objectBuffer);
+    state.bindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, commandBuffer);
+    glDispatchCompute(((GLuint)objects.size() + GROUP_SIZE - 1) / GROUP_SIZE,
+                      1, 1);
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT);
+
+    prog->Use();
+    state.bindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+    geometry.DrawIndirect(type, (int)objects.size());
+}
+
+
+/**
+ * @brief Culls the objects against the viewport and draws the rest in one
+ * colour.
+ *
+ * @param color Value of the "color" uniform of prog.
+ */
+void IndirectDrawList::draw(GPUProgram* prog, int type, vec3 color,
+                            const mat4& view) {
+    prog->Use();
+    prog->setUniform(color, "color");
+    draw(prog, type, view);
+}
@@ -0,0 +1,66 @@
+#ifndef INDIRECTDRAWLIST_H
+#define INDIRECTDRAWLIST_H
+
+
+#include "framework.h"
+#include <cstddef>
+#include <vector>
+
+
+/**
+ * @class IndirectDrawList
+ * @brief Draws many independent objects of one primitive type with a single
+ * glMultiDrawArraysIndirect call, culled against the viewport on the GPU.
+ *
+ * add() appends the vertices of an object to one shared vertex buffer and
+ * records its range and bounding box. draw() uploads what changed, then runs
+ * a compute shader with one invocation per object: it transforms the eight
+ * corners of the box by the view matrix and writes a
+ * DrawArraysIndirectCommand for the object, with an instance count of 0 if
+ * every corner lies beyond the same side of the viewport. The commands stay
+ * in submission order, so overlapping objects are drawn as if one by one,
+ * and the CPU cost of a frame does not depend on the number of objects.
+ *
+ * Vertex attribute 1 holds the index of the object being drawn, as a uint:
+ * a vertex shader declaring layout(location = 1) in uint objectIndex can
+ * look up per-object parameters, such as a transform or a colour, in a
+ * StorageArray filled in the order of add().
+ *
+ * The boxes hold the vertices only: a wide point or line whose vertices are
+ * all just outside the viewport is culled although its edge would show.
+ * Like Geometry, the list must be used on the thread that owns the GL
+ * context.
+ */
+class IndirectDrawList {
+
+    struct Object { // std430 layout of the culling shader
+        vec4 low, high; // bounding box
+        GLuint first, count; // vertex range
+        GLuint padding[2];
+    };
+
+    Geometry<vec3> geometry;
+    std::vector<Object> objects;
+    GPUProgram culler;
+    GLuint objectBuffer = 0, commandBuffer = 0;
+    GLuint indexBuffer = 0; // 0, 1, 2, ... read through the base instance
+    std::size_t capacity = 0; // objects the command and index buffers hold
+    bool dirty = false;
+
+    void upload();
+
+  public:
+    IndirectDrawList();
+    IndirectDrawList(const IndirectDrawList&) = delete;
+    IndirectDrawList& operator=(const IndirectDrawList&) = delete;
+    ~IndirectDrawList();
+
+    std::size_t add(const vec3* vertices, std::size_t count);
+    void clear();
+    void draw(GPUProgram* prog, int type, const mat4& view);
+    void draw(GPUProgram* prog, int type, vec3 color, const mat4& view);
+
+    [[nodiscard]] std::size_t size() const { return objects.size(); }
+};
+
+#endif
@@ -3,6 +3,14 @@
 #include "Line.h"
 
 
+namespace {
+
+const vec3 LINE_COLOUR(0, 1, 1); // cyan
+constexpr float LINE_WIDTH = 3.0f;
+
+} // namespace
+
+
 /**
  * @brief Constructs a Line object given two points.
  *
@@ -94,26 +102,24 @@ void Line::translate(const vec3 newPoint) {
 
 
 /**
- * @brief Renders the line segment within the unit square using a GPU program.
+ * @brief Clips the line to the unit square.
  *
  * This method calculates the intersection points of the line with the
  * boundaries of the unit square in normalized device coordinates (NDC: [-1, 1]
- * for both x and y axes). If the line intersects the square, it renders the
- * visible segment using the specified GPU program.
- *
- * @param prog A pointer to the GPUProgram used for rendering the line.
+ * for both x and y axes).
  *
  * The method operates as follows:
  * - Computes the parametric intersection points of the line with the square
  * boundaries.
  * - Determines valid endpoints that lie within the bounds of the square.
- * - If at least two valid endpoints are found, they are sent to the GPU for
- * rendering.
  *
- * The rendered line segment is drawn with a width of 3 and a cyan color (RGB:
- * (0, 1, 1)).
+ * @param from Set to the first endpoint of the visible segment.
+ * @param to Set to the second endpoint of the visible segment.
+ *
+ * @return True if at least two valid endpoints were found, false if the line
+ * misses the square.
  */
-void Line::draw(GPUProgram* prog) const {
+bool Line::visibleSegment(vec3& from, vec3& to) const {
     const vec3 direction = p2 - p1;
     std::vector<vec3> endpoints;
 
@@ -143,13 +149,52 @@ void Line::draw(GPUProgram* prog) const {
             endpoints.push_back(y_max);
     }
 
-    if (endpoints.size() >= 2) {
-        Geometry<vec3> geom;
-        geom.Vtx() = {endpoints[0], endpoints[1]};
-        geom.updateGPU();
-        glLineWidth(3.0f);
-        geom.Draw(prog, GL_LINES, vec3(0, 1, 1));
-    }
+    if (endpoints.size() < 2)
+        return false;
+    from = endpoints[0];
+    to = endpoints[1];
+    return true;
+}
+
+
+/**
+ * @brief Renders the line segment within the unit square using a GPU program.
+ *
+ * The visible segment is drawn at once, with a width of 3 and a cyan color
+ * (RGB: (0, 1, 1)).
+ *
+ * @param prog A pointer to the GPUProgram used for rendering the line.
+ */
+void Line::draw(GPUProgram* prog) const {
+    vec3 from, to;
+    if (!visibleSegment(from, to))
+        return;
+    Geometry<vec3> geom;
+    geom.Vtx() = {from, to};
+    geom.updateGPU();
+    GLState::instance().setLineWidth(LINE_WIDTH);
+    geom.Draw(prog, GL_LINES, LINE_COLOUR);
+}
+
+
+/**
+ * @brief Queues the line segment within the unit square, drawn like draw()
+ * does, for the next flush of the queue.
+ *
+ * @param queue The queue to record the segment in.
+ * @param prog A pointer to the GPUProgram used for rendering the line.
+ * @param layer Layer of the segment in the queue.
+ */
+void Line::submit(RenderQueue& queue, GPUProgram* prog,
+                  const unsigned layer) const {
+    vec3 segment[2];
+    if (visibleSegment(segment[0], segment[1]))
+        queue.submit({.program = prog,
+                      .primitive = GL_LINES,
+                      .colour = LINE_COLOUR,
+                      .size = LINE_WIDTH,
+                      .layer = layer},
+                     segment, 2);
 }
 
 
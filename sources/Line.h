@@ -2,7 +2,7 @@
 #define LINE_H
 
 
-#include "framework.h"
+#include "RenderQueue.h"
 #include <stdio.h>
 
 
@@ -26,7 +26,10 @@ class Line {
     [[nodiscard]] vec3 computeIntersection(const Line& other) const;
 
     void translate(vec3 newPoint);
+    [[nodiscard]] bool visibleSegment(vec3& from, vec3& to) const;
     void draw(GPUProgram* prog) const;
+    void submit(RenderQueue& queue, GPUProgram* prog,
+                unsigned layer = 0) const;
     void printEquations() const;
 };
 
@@ -36,3 +36,14 @@ void LineCollection::draw(GPUProgram* prog) const {
     for (const auto& line : lines)
         line.draw(prog);
 }
+
+
+/**
+ * Queues all lines in the collection on one layer. The queue draws them with
+ * a single call.
+ */
+void LineCollection::submit(RenderQueue& queue, GPUProgram* prog,
+                            const unsigned layer) const {
+    for (const auto& line : lines)
+        line.submit(queue, prog, layer);
+}
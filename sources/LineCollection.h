@@ -23,6 +23,8 @@ class LineCollection {
     void addLine(vec3 p1, vec3 p2);
     Line* findNearestLine(vec3 p);
     void draw(GPUProgram* prog) const;
+    void submit(RenderQueue& queue, GPUProgram* prog,
+                unsigned layer = 0) const;
 
     std::vector<Line>& getLines() { return lines; }
 };
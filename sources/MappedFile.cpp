@@ -0,0 +1,97 @@
+
+
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#    include <fstream>
+#else
+#    include <fcntl.h>
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#    include <unistd.h>
+#endif
+
+
+/**
+ * @brief Maps the given file into memory.
+ *
+ * If the file cannot be opened or mapped, the object is left closed and
+ * isOpen() returns false.
+ *
+ * @param path The file to map.
+ */
+MappedFile::MappedFile(const std::filesystem::path& path) {
+#ifdef _WIN32
+    std::ifstream stream(path, std::ios::binary | std::ios::ate);
+    if (!stream.is_open())
+        return;
+    length = static_cast<std::size_t>(stream.tellg());
+    char* buffer = new char[length + 1];
+    stream.seekg(0);
+    stream.read(buffer, static_cast<std::streamsize>(length));
+    buffer[length] = '\0';
+    bytes = buffer;
+    valid = true;
+#else
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return;
+    struct stat st{};
+    if (fstat(fd, &st) == 0) {
+        length = static_cast<std::size_t>(st.st_size);
+        if (length == 0) {
+            valid = true;
+        } else if (void* p = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd,
+                                  0);
+                   p != MAP_FAILED) {
+            bytes = static_cast<const char*>(p);
+            mapped = true;
+            valid = true;
+        }
+    }
+    close(fd);
+#endif
+}
+
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : bytes(other.bytes), length(other.length), mapped(other.mapped),
+      valid(other.valid) {
+    other.bytes = nullptr;
+    other.length = 0;
+    other.mapped = false;
+    other.valid = false;
+}
+
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        release();
+        bytes = other.bytes;
+        length = other.length;
+        mapped = other.mapped;
+        valid = other.valid;
+        other.bytes = nullptr;
+        other.length = 0;
+        other.mapped = false;
+        other.valid = false;
+    }
+    return *this;
+}
+
+
+/**
+ * @brief Unmaps or frees the file content.
+ */
+void MappedFile::release() {
+#ifdef _WIN32
+    delete[] bytes;
+#else
+    if (mapped)
+        munmap(const_cast<char*>(bytes), length);
+#endif
+    bytes = nullptr;
+    length = 0;
+    mapped = false;
+    valid = false;
+}
@@ -0,0 +1,45 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+
+#include <cstddef>
+#include <filesystem>
+#include <string_view>
+
+
+/**
+ * @class MappedFile
+ * @brief Read-only memory mapping of a whole file.
+ *
+ * On POSIX systems the file is mapped with mmap, so reading it costs no copy
+ * and no buffered stream I/O. On other platforms the content is read into a
+ * heap buffer in a single call. Empty files are represented by a valid, empty
+ * view.
+ */
+class MappedFile {
+
+    const char* bytes = nullptr;
+    std::size_t length = 0;
+    bool mapped = false;
+    bool valid = false;
+
+    void release();
+
+  public:
+    MappedFile() = default;
+    explicit MappedFile(const std::filesystem::path& path);
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    ~MappedFile() { release(); }
+
+    [[nodiscard]] bool isOpen() const { return valid; }
+    [[nodiscard]] const char* data() const { return bytes; }
+    [[nodiscard]] std::size_t size() const { return length; }
+    [[nodiscard]] std::string_view view() const { return {bytes, length}; }
+};
+
+#endif
@@ -1,7 +1,10 @@
 
 
 #include "LineCollection.h"
+#include "ParameterBlock.h"
 #include "PointCollection.h"
+#include "RenderQueue.h"
+#include "SnapshotBuffer.h"
 
 
 /**
@@ -20,6 +23,22 @@ class MyApp final : public glApp {
     PointCollection points;
     LineCollection lines;
     GPUProgram* shaderProg = nullptr;
+    RenderQueue* renderQueue = nullptr;
+    PointSprites* pointSprites = nullptr;
+
+    /// Parameters shared by every draw of a frame, in the uniform block Frame
+    struct FrameParameters {
+        mat4 view;
+    };
+    static constexpr GLuint FRAME_BINDING = 0;
+    UniformBlock<FrameParameters>* frameBlock = nullptr;
+
+    /// Immutable copy of the scene, handed from the input to the render thread
+    struct Scene {
+        PointCollection points;
+        LineCollection lines;
+    };
+    SnapshotBuffer<Scene> scene;
 
     vec3 firstPoint;
     bool firstSelected = false;
@@ -31,9 +50,12 @@ class MyApp final : public glApp {
         #version 330 core
         layout(location = 0) in vec3 aPos;
         uniform vec3 color;
+        layout(std140) uniform Frame {
+            mat4 view;
+        };
         out vec3 fragColor;
         void main() {
-            gl_Position = vec4(aPos, 1.0);
+            gl_Position = view * vec4(aPos, 1.0);
             fragColor = color;
         }
     )";
@@ -49,20 +71,28 @@ class MyApp final : public glApp {
 
 
   public:
-    MyApp() : glApp(4, 5, 600, 600, "Grafika") {}
+    MyApp() : glApp(4, 5, 600, 600, "Grafika") {
+        setEventDriven(true); // nothing animates, sleep until input arrives
+        setCoalesceMotion(true); // drag with one translate per frame
+        setRenderThread(true);   // scene edits never stall the display
+    }
 
 
     /**
      * @brief Initializes the OpenGL application.
      *
      * This method is overridden to set up the initial OpenGL state and
-     * resources. It enables point smoothing for better visual rendering of
-     * points and initializes the shader program with predefined vertex and
-     * fragment shader source codes.
+     * resources. It initializes the shader program with predefined vertex and
+     * fragment shader source codes, the render queue, the point sprites that
+     * draw the points as round dots, and the uniform buffer of the per-frame
+     * parameters.
      */
     void onInitialization() override {
-        glEnable(GL_POINT_SMOOTH);
         shaderProg = new GPUProgram(vertexShaderSource, fragmentShaderSource);
+        shaderProg->setUniformBlock("Frame", FRAME_BINDING);
+        renderQueue = new RenderQueue();
+        pointSprites = new PointSprites();
+        frameBlock = new UniformBlock<FrameParameters>();
     }
 
 
@@ -72,17 +102,44 @@ class MyApp final : public glApp {
      *
      * This function overrides the `onDisplay` method from the base class. It
      * sets a background color using `glClearColor` with a gray tone and clears
-     * the screen via `glClear`. Then, it invokes the `draw` method on both
-     * `lines` and `points` objects to render all stored line and point
-     * elements, respectively.
+     * the screen via `glClear`. Then, it submits the lines of the latest
+     * published scene snapshot to the render queue and flushes it, drawing
+     * all lines in one call, and draws the points over them as point sprites
+     * in another. Since it never touches the live collections, it may run on
+     * the render thread while the main thread edits the scene. The
+     * framework's view transform is passed to the vertex shaders, in the
+     * per-frame uniform block for the lines, so the scene can also be
+     * rendered as poster tiles.
      */
     void onDisplay() override {
         glClearColor(0.2f, 0.2f, 0.2f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT);
 
+        const Scene& snapshot = scene.acquire();
+        frameBlock->Data().view = viewTransform();
+        frameBlock->update();
+        frameBlock->Bind(FRAME_BINDING);
         shaderProg->Use();
-        lines.draw(shaderProg);
-        points.draw(shaderProg);
+        snapshot.lines.submit(*renderQueue, shaderProg);
+        renderQueue->flush();
+        pointSprites->clear();
+        snapshot.points.submit(*pointSprites);
+        pointSprites->draw(viewTransform());
+    }
+
+
+    /**
+     * Publishes a copy of the current points and lines for rendering.
+     *
+     * Called after every change of the scene, right before `refreshScreen`.
+     * The copy reuses the memory of an older snapshot, and publishing never
+     * waits for the render thread.
+     */
+    void publishScene() {
+        Scene& next = scene.back();
+        next.points = points;
+        next.lines = lines;
+        scene.publish();
     }
 
 
@@ -93,12 +150,19 @@ class MyApp final : public glApp {
      * This function overrides the `onKeyboard` method from the base class.
      * Depending on the key pressed ('p', 'l', 'm', or 'i'), it changes the
      * drawing mode in the application. It also resets flags related to point
-     * and line selections, and clears any currently selected line.
+     * and line selections, and clears any currently selected line. The 's' key
+     * saves the scene at four times the window size to `poster.png`; larger
+     * posters are made with GFX_POSTER and GFX_POSTER_SIZE.
      *
      * @param key The key that was pressed. Only 'p', 'l', 'm', and 'i' are
-     * handled to change the mode. Other keys have no effect.
+     * handled to change the mode, and 's' to save a poster. Other keys have no
+     * effect.
      */
     void onKeyboard(const int key) override {
+        if (key == 's') {
+            renderPoster("poster.png", 4 * 600, 4 * 600); // 2400x2400
+            return;
+        }
         if (key == 'p' || key == 'l' || key == 'm' || key == 'i') {
             mode = static_cast<char>(key);
             firstSelected = false;
@@ -125,7 +189,8 @@ class MyApp final : public glApp {
      * - 'i': Selects two lines to calculate their intersection point, if it
      * exists, and adds the intersection point to the point collection.
      *
-     * The function also ensures the screen is refreshed after each action.
+     * The function also publishes the changed scene and ensures the screen is
+     * refreshed after each action.
      *
      * @param button The mouse button pressed (e.g., left, middle, or right).
      * @param pX The x-coordinate of the mouse press in pixel space.
@@ -153,6 +218,7 @@ class MyApp final : public glApp {
                 break;
         }
 
+        publishScene();
         refreshScreen();
     }
 
@@ -279,6 +345,7 @@ class MyApp final : public glApp {
         if (mode == 'm' && selectedLine) {
             const vec3 newCursorPos = calculateNormalizedPoint(px, py);
             selectedLine->translate(newCursorPos);
+            publishScene();
             refreshScreen();
         }
     }
@@ -304,6 +371,11 @@ class MyApp final : public glApp {
     }
 
 
-    ~MyApp() override { delete shaderProg; }
+    ~MyApp() override {
+        delete frameBlock;
+        delete pointSprites;
+        delete renderQueue;
+        delete shaderProg;
+    }
 
 } app;
@@ -0,0 +1,108 @@
+#ifndef PARAMETERBLOCK_H
+#define PARAMETERBLOCK_H
+
+
+#include "GLState.h"
+#include <cstddef>
+#include <vector>
+
+
+/**
+ * @class UniformBlock
+ * @brief One struct of shader parameters in a uniform buffer, such as the
+ * parameters of a frame.
+ *
+ * Fill Data() and call update() to send the whole struct with a single
+ * buffer write, instead of one glUniform call per parameter. Bind() attaches
+ * the buffer to a uniform buffer binding point; GPUProgram::setUniformBlock()
+ * connects a block of a program to the same point.
+ *
+ * @tparam T The parameters. Its layout must match the std140 block in the
+ * shader: vec4 and mat4 members line up, a vec3 must be followed by a float
+ * or padded to 16 bytes.
+ */
+template <class T>
+class UniformBlock {
+
+    GLuint buffer = 0;
+    T data{};
+
+  public:
+    UniformBlock() {
+        glGenBuffers(1, &buffer);
+        GLState::instance().bindBuffer(GL_UNIFORM_BUFFER, buffer);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(T), &data, GL_DYNAMIC_DRAW);
+    }
+    UniformBlock(const UniformBlock&) = delete;
+    UniformBlock& operator=(const UniformBlock&) = delete;
+
+    T& Data() { return data; }
+
+    // CPU -> GPU
+    void update() {
+        GLState::instance().bindBuffer(GL_UNIFORM_BUFFER, buffer);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(T), &data);
+    }
+
+    void Bind(GLuint binding) const {
+        GLState::instance().bindBufferBase(GL_UNIFORM_BUFFER, binding,
+                                           buffer);
+    }
+
+    ~UniformBlock() { GLState::instance().deleteBuffers(1, &buffer); }
+};
+
+
+/**
+ * @class StorageArray
+ * @brief An array of per-object shader parameters in a shader storage
+ * buffer.
+ *
+ * Fill Items() and call update() to send the parameters of every object with
+ * a single buffer write. A vertex shader reads the entry of its object from
+ * a std430 buffer block at the binding point given to Bind(), indexed by
+ * gl_InstanceID in an instanced draw, or by the object index attribute of an
+ * IndirectDrawList.
+ *
+ * @tparam T The parameters of an object. Its layout must match the array
+ * element in the shader under std430: vec4 and mat4 members line up, a vec3
+ * must be followed by a float or padded to 16 bytes.
+ */
+template <class T>
+class StorageArray {
+
+    GLuint buffer = 0;
+    std::vector<T> items;
+    std::size_t capacity = 0; // items the buffer holds
+
+  public:
+    StorageArray() { glGenBuffers(1, &buffer); }
+    StorageArray(const StorageArray&) = delete;
+    StorageArray& operator=(const StorageArray&) = delete;
+
+    std::vector<T>& Items() { return items; }
+
+    // CPU -> GPU, growing the buffer when there are more items than it holds
+    void update() {
+        if (items.empty())
+            return;
+        GLState::instance().bindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+        if (items.size() > capacity) {
+            capacity = items.size();
+            glBufferData(GL_SHADER_STORAGE_BUFFER, capacity * sizeof(T),
+                         items.data(), GL_DYNAMIC_DRAW);
+        } else {
+            glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0,
+                            items.size() * sizeof(T), items.data());
+        }
+    }
+
+    void Bind(GLuint binding) const {
+        GLState::instance().bindBufferBase(GL_SHADER_STORAGE_BUFFER, binding,
+                                           buffer);
+    }
+
+    ~StorageArray() { GLState::instance().deleteBuffers(1, &buffer); }
+};
+
+#endif
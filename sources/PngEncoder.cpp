@@ -0,0 +1,291 @@
+
+
+#include "PngEncoder.h"
+#include "lodepng.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+
+namespace {
+
+constexpr std::size_t BYTES_PER_PIXEL = 4;
+constexpr std::size_t BLOCK_SIZE = std::size_t(128) << 10;
+constexpr std::size_t WINDOW_SIZE = 32768;
+constexpr unsigned ADLER_BASE = 65521;
+
+void putBigEndian(unsigned char* out, const unsigned value) {
+    out[0] = static_cast<unsigned char>(value >> 24);
+    out[1] = static_cast<unsigned char>(value >> 16);
+    out[2] = static_cast<unsigned char>(value >> 8);
+    out[3] = static_cast<unsigned char>(value);
+}
+
+unsigned char paeth(const int a, const int b, const int c) {
+    const int p = a + b - c;
+    const int pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+    if (pa <= pb && pa <= pc)
+        return static_cast<unsigned char>(a);
+    return static_cast<unsigned char>(pb <= pc ? b : c);
+}
+
+std::size_t magnitude(const unsigned char value) {
+    return value < 128 ? value : 256 - value;
+}
+
+/**
+ * @brief Filters a row with one predictor and returns the sum of the absolute
+ * values. The first pixel has no left neighbour, so a and c are 0 there.
+ */
+template <typename Predict>
+std::size_t filterWith(const unsigned char* row, const unsigned char* up,
+                       const std::size_t size, unsigned char* out,
+                       const Predict& predict) {
+    std::size_t sum = 0;
+    const std::size_t first = std::min(size, BYTES_PER_PIXEL);
+    for (std::size_t i = 0; i < first; ++i) {
+        out[i] = static_cast<unsigned char>(row[i] - predict(0, up[i], 0));
+        sum += magnitude(out[i]);
+    }
+    for (std::size_t i = first; i < size; ++i) {
+        out[i] = static_cast<unsigned char>(
+            row[i] - predict(row[i - BYTES_PER_PIXEL], up[i],
+                             up[i - BYTES_PER_PIXEL]));
+        sum += magnitude(out[i]);
+    }
+    return sum;
+}
+
+/**
+ * @brief Adler32 of two concatenated pieces from the checksums of each, as
+ * adler32_combine of zlib does.
+ */
+unsigned combineAdler(const unsigned first, const unsigned second,
+                      const std::size_t secondSize) {
+    const std::uint64_t remainder = secondSize % ADLER_BASE;
+    const std::uint64_t a1 = first & 0xffff, b1 = first >> 16;
+    const std::uint64_t a2 = second & 0xffff, b2 = second >> 16;
+    const std::uint64_t a = (a1 + a2 + ADLER_BASE - 1) % ADLER_BASE;
+    const std::uint64_t b =
+        (remainder * a1 + b1 + b2 + ADLER_BASE - remainder) % ADLER_BASE;
+    return static_cast<unsigned>(a | (b << 16));
+}
+
+/**
+ * @brief Runs body(i) for i in [0, count) on up to threadCount threads, each
+ * taking the next index when done with the previous one.
+ */
+template <typename Body>
+void forEachIndex(const std::size_t count, const unsigned threadCount,
+                  const Body& body) {
+    std::atomic<std::size_t> next{0};
+    const auto work = [&] {
+        for (std::size_t i = next++; i < count; i = next++)
+            body(i);
+    };
+    std::vector<std::thread> threads;
+    const std::size_t extra = std::min<std::size_t>(threadCount, count);
+    for (std::size_t t = 1; t < extra; ++t)
+        threads.emplace_back(work);
+    work();
+    for (std::thread& thread : threads)
+        thread.join();
+}
+
+/**
+ * @brief Appends a chunk with its length and CRC.
+ */
+void appendChunk(std::vector<unsigned char>& out, const char* type,
+                 const unsigned char* data, const std::size_t size) {
+    const std::size_t start = out.size();
+    out.resize(start + 12 + size);
+    unsigned char* chunk = out.data() + start;
+    putBigEndian(chunk, static_cast<unsigned>(size));
+    memcpy(chunk + 4, type, 4);
+    if (size > 0)
+        memcpy(chunk + 8, data, size);
+    // the CRC covers the type and the data
+    putBigEndian(chunk + 8 + size, lodepng_crc32(chunk + 4, size + 4));
+}
+
+} // namespace
+
+
+/**
+ * @param threadCount Number of threads, 0 to use every core.
+ */
+PngEncoder::PngEncoder(const unsigned threadCount)
+    : threadCount(threadCount ? threadCount
+                              : std::max(std::thread::hardware_concurrency(),
+                                         1u)) {}
+
+
+/**
+ * @brief Filters one RGBA8 scanline with the filter type that gives the
+ * smallest sum of absolute values, like lodepng does for RGBA.
+ *
+ * @param row The scanline.
+ * @param up The scanline above it, all zeros for the first one.
+ * @param size Bytes in a scanline.
+ * @param out Receives the filter type followed by size filtered bytes.
+ * @param scratch Reused between calls to hold the candidates.
+ */
+void PngEncoder::filterRow(const unsigned char* row, const unsigned char* up,
+                           const std::size_t size, unsigned char* out,
+                           std::vector<unsigned char>& scratch) {
+    scratch.resize(2 * size);
+    unsigned char* best = scratch.data();
+    unsigned char* trial = best + size;
+    const unsigned char* bestData = row;
+    unsigned char bestType = 0;
+    std::size_t bestSum = 0;
+    for (std::size_t i = 0; i < size; ++i)
+        bestSum += magnitude(row[i]);
+
+    for (unsigned char type = 1; type < 5; ++type) {
+        std::size_t sum = 0;
+        switch (type) {
+        case 1:
+            sum = filterWith(row, up, size, trial,
+                             [](int a, int, int) { return a; });
+            break;
+        case 2:
+            sum = filterWith(row, up, size, trial,
+                             [](int, int b, int) { return b; });
+            break;
+        case 3:
+            sum = filterWith(row, up, size, trial,
+                             [](int a, int b, int) { return (a + b) / 2; });
+            break;
+        default:
+            sum = filterWith(row, up, size, trial, [](int a, int b, int c) {
+                return paeth(a, b, c);
+            });
+            break;
+        }
+        if (sum < bestSum) {
+            bestSum = sum;
+            bestType = type;
+            std::swap(best, trial);
+            bestData = best;
+        }
+    }
+    out[0] = bestType;
+    memcpy(out + 1, bestData, size);
+}
+
+
+/**
+ * @brief Encodes an image to PNG in memory.
+ *
+ * @param png Receives the file contents.
+ * @param rgba The pixels, RGBA8, top row first.
+ * @param width Width of the image in pixels.
+ * @param height Height of the image in pixels.
+ * @return Error code of lodepng, 0 on success.
+ */
+unsigned PngEncoder::encode(std::vector<unsigned char>& png,
+                            const unsigned char* rgba, const unsigned width,
+                            const unsigned height) const {
+    if (width == 0 || height == 0)
+        return 93; // zero width or height
+    const std::size_t rowSize = std::size_t(width) * BYTES_PER_PIXEL;
+    const std::size_t lineSize = rowSize + 1; // with the filter type byte
+    const std::size_t blockRows =
+        std::max<std::size_t>(1, BLOCK_SIZE / lineSize);
+    const std::size_t blockCount = (height + blockRows - 1) / blockRows;
+
+    std::vector<unsigned char> filtered(lineSize * height);
+    const std::vector<unsigned char> zeros(rowSize, 0);
+    forEachIndex(blockCount, threadCount, [&](std::size_t block) {
+        std::vector<unsigned char> scratch;
+        const std::size_t end = std::min<std::size_t>(
+            height, (block + 1) * blockRows);
+        for (std::size_t y = block * blockRows; y < end; ++y)
+            filterRow(rgba + y * rowSize,
+                      y > 0 ? rgba + (y - 1) * rowSize : zeros.data(),
+                      rowSize, filtered.data() + y * lineSize, scratch);
+    });
+
+    struct Block {
+        std::vector<unsigned char> chunk; // a complete IDAT chunk
+        unsigned adler = 1;
+        unsigned error = 0;
+    };
+    std::vector<Block> blocks(blockCount);
+    LodePNGCompressSettings settings;
+    lodepng_compress_settings_init(&settings);
+    forEachIndex(blockCount, threadCount, [&](std::size_t index) {
+        Block& block = blocks[index];
+        const std::size_t start = index * blockRows * lineSize;
+        const std::size_t end =
+            std::min(filtered.size(), start + blockRows * lineSize);
+        const std::size_t dictionary = std::min(start, WINDOW_SIZE);
+        unsigned char* data = nullptr;
+        std::size_t size = 0;
+        block.error = lodepng_deflate_chunk(
+            &data, &size, filtered.data() + start - dictionary, dictionary,
+            dictionary + end - start, &settings, index + 1 == blockCount);
+        block.adler = lodepng_update_adler32(1, filtered.data() + start,
+                                             end - start);
+        if (!block.error) {
+            const std::size_t headerSize = index == 0 ? 2 : 0;
+            std::vector<unsigned char> body(headerSize + size);
+            if (headerSize) {
+                body[0] = 0x78; // zlib header
+                body[1] = 0x01;
+            }
+            memcpy(body.data() + headerSize, data, size);
+            appendChunk(block.chunk, "IDAT", body.data(), body.size());
+        }
+        free(data);
+    });
+
+    static const unsigned char signature[8] = {137, 80, 78, 71,
+                                               13,  10, 26, 10};
+    unsigned char header[13];
+    putBigEndian(header, width);
+    putBigEndian(header + 4, height);
+    header[8] = 8;  // bit depth
+    header[9] = 6;  // RGBA
+    header[10] = 0; // deflate
+    header[11] = 0; // adaptive filtering
+    header[12] = 0; // no interlace
+    png.assign(signature, signature + 8);
+    appendChunk(png, "IHDR", header, sizeof(header));
+
+    unsigned adler = 1;
+    for (std::size_t i = 0; i < blockCount; ++i) {
+        if (blocks[i].error)
+            return blocks[i].error;
+        const std::size_t size =
+            std::min(filtered.size(), (i + 1) * blockRows * lineSize) -
+            i * blockRows * lineSize;
+        adler = combineAdler(adler, blocks[i].adler, size);
+        png.insert(png.end(), blocks[i].chunk.begin(), blocks[i].chunk.end());
+    }
+    unsigned char trailer[4];
+    putBigEndian(trailer, adler);
+    appendChunk(png, "IDAT", trailer, sizeof(trailer));
+    appendChunk(png, "IEND", nullptr, 0);
+    return 0;
+}
+
+
+/**
+ * @brief Encodes an image and writes it to a file.
+ *
+ * @return Error code of lodepng, 0 on success.
+ */
+unsigned PngEncoder::save(const std::filesystem::path& path,
+                          const unsigned char* rgba, const unsigned width,
+                          const unsigned height) const {
+    std::vector<unsigned char> png;
+    const unsigned error = encode(png, rgba, width, height);
+    if (error)
+        return error;
+    return lodepng_save_file(png.data(), png.size(), path.string().c_str());
+}
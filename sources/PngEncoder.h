@@ -0,0 +1,42 @@
+#ifndef PNGENCODER_H
+#define PNGENCODER_H
+
+
+#include <cstddef>
+#include <filesystem>
+#include <vector>
+
+
+/**
+ * @class PngEncoder
+ * @brief Encodes RGBA8 images to PNG on several threads.
+ *
+ * The image is cut into blocks of rows, about 128 KiB of scanlines each. The
+ * rows of all blocks are filtered in parallel, each with the filter type of
+ * the smallest sum of absolute values. Then every block is compressed on its
+ * own with lodepng_deflate_chunk(), primed with the end of the previous block
+ * as dictionary and ended with a sync flush, like pigz does; its adler32 and
+ * the CRC of its IDAT chunk are computed by the same thread. The blocks are
+ * joined in order and the adler32 values combined, so the result is a single
+ * standard zlib stream in a standard, non-interlaced PNG.
+ *
+ * Errors are lodepng error codes, readable with lodepng_error_text().
+ */
+class PngEncoder {
+
+    unsigned threadCount;
+
+  public:
+    explicit PngEncoder(unsigned threadCount = 0);
+
+    static void filterRow(const unsigned char* row, const unsigned char* up,
+                          std::size_t size, unsigned char* out,
+                          std::vector<unsigned char>& scratch);
+
+    unsigned encode(std::vector<unsigned char>& png, const unsigned char* rgba,
+                    unsigned width, unsigned height) const;
+    unsigned save(const std::filesystem::path& path, const unsigned char* rgba,
+                  unsigned width, unsigned height) const;
+};
+
+#endif
@@ -0,0 +1,398 @@
+
+
+#include "PngStreamReader.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+
+namespace {
+
+constexpr std::size_t INPUT_SIZE = std::size_t(64) << 10;
+// compressed data kept ahead of the decoder: several deflate blocks, so that
+// few blocks are cut off by the end of the input and decoded again
+constexpr std::size_t LOOKAHEAD = std::size_t(256) << 10;
+// 2^28 pixels, a 16384x16384 texture: its RGBA8 image and mip chain
+// take under 2 GB, and no row size or byte count can overflow a size_t
+constexpr std::uint64_t MAX_PIXELS = std::uint64_t(1) << 28;
+// longer than any PLTE or tRNS chunk can be
+constexpr std::uint32_t MAX_PALETTE_CHUNK = 256 * 3;
+
+std::uint32_t readBigEndian(const unsigned char* in) {
+    return std::uint32_t(in[0]) << 24 | std::uint32_t(in[1]) << 16 |
+           std::uint32_t(in[2]) << 8 | std::uint32_t(in[3]);
+}
+
+
+/**
+ * @brief Bytes to reserve for an RGBA8 image and, if asked, the levels that
+ * halve it down to 1x1: a third of the image plus a row of each side.
+ */
+std::size_t capacityFor(const unsigned width, const unsigned height,
+                        const bool mipmapRoom) {
+    const std::size_t size = std::size_t(width) * height * 4;
+    if (!mipmapRoom)
+        return size;
+    return size + size / 3 + 4 * (std::size_t(width) + height + 64);
+}
+
+} // namespace
+
+
+PngStreamReader::PngStreamReader() {
+    lodepng_state_init(&state);
+    lodepng_zlib_stream_init(&zlib, &state.decoder.zlibsettings);
+}
+
+
+PngStreamReader::~PngStreamReader() {
+    close();
+    lodepng_state_cleanup(&state);
+}
+
+
+/**
+ * @brief Opens a PNG and reads its chunks up to the image data.
+ *
+ * @param path The PNG file.
+ * @param keepAlphaChannel False to make every pixel opaque, like
+ * lodepng_decode24 does.
+ * @return 0 on success, UNSUPPORTED if the image must be decoded with
+ * lodepng, or a lodepng error code: 92 for more than 2^28 pixels, 57 for a
+ * chunk with a wrong CRC, 83 if the row buffers cannot be allocated.
+ */
+unsigned PngStreamReader::open(const std::filesystem::path& path,
+                               const bool keepAlphaChannel) {
+    close();
+    width = height = rowsRead = 0;
+    error = 0;
+    inputPos = inputEnd = 0;
+    chunkLeft = 0;
+    inChunk = dataEnded = false;
+    keepAlpha = keepAlphaChannel;
+    lodepng_zlib_stream_init(&zlib, &state.decoder.zlibsettings);
+    file = fopen(path.string().c_str(), "rb");
+    if (!file)
+        return error = 78;
+    input.resize(INPUT_SIZE);
+
+    // signature and IHDR, whose CRC lodepng_inspect checks
+    unsigned char head[33];
+    if (!readRaw(head, sizeof(head)))
+        return error = 27;
+    if ((error = lodepng_inspect(&width, &height, &state, head, sizeof(head))))
+        return error;
+    if (std::uint64_t(width) * height > MAX_PIXELS)
+        return error = 92; // too many pixels
+    if (state.info_png.interlace_method != 0)
+        return error = UNSUPPORTED; // Adam7
+
+    while (nextChunk() && !isChunk("IDAT")) {
+        if (isChunk("IEND"))
+            return error = 48; // no image data
+        if (!(chunkType[0] & 32) && !isChunk("PLTE"))
+            return error = 69; // unknown critical chunk
+    }
+    if (error)
+        return error;
+    const LodePNGColorMode& color = state.info_png.color;
+    if (color.colortype == LCT_PALETTE && !color.palette)
+        return error = 106;
+
+    const unsigned bpp = lodepng_get_bpp(&color);
+    lineSize = (std::size_t(width) * bpp + 7) / 8;
+    pixelBytes = (bpp + 7) / 8;
+    try {
+        line.resize(lineSize);
+        previousLine.resize(lineSize);
+    } catch (const std::bad_alloc&) {
+        return error = 83;
+    }
+    return 0;
+}
+
+
+/**
+ * @brief Refills the input buffer from the file.
+ *
+ * @return False at the end of the file.
+ */
+bool PngStreamReader::fillInput() {
+    inputEnd = fread(input.data(), 1, input.size(), file);
+    inputPos = 0;
+    return inputEnd > 0;
+}
+
+
+/**
+ * @brief Reads bytes that are not chunk data: headers and CRCs.
+ */
+bool PngStreamReader::readRaw(unsigned char* out, std::size_t size) {
+    while (size > 0) {
+        if (inputPos == inputEnd && !fillInput())
+            return false;
+        const std::size_t count = std::min(size, inputEnd - inputPos);
+        memcpy(out, input.data() + inputPos, count);
+        inputPos += count;
+        out += count;
+        size -= count;
+    }
+    return true;
+}
+
+
+/**
+ * @brief Takes up to count bytes of the current chunk's data from the input
+ * buffer and adds them to its CRC.
+ *
+ * @param count Bytes wanted; set to the bytes taken.
+ * @return The bytes, valid until the input is read again.
+ */
+const unsigned char* PngStreamReader::takeChunkData(std::size_t& count) {
+    if (inputPos == inputEnd && !fillInput()) {
+        error = 30; // the file ends inside the chunk
+        count = 0;
+        return nullptr;
+    }
+    count = std::min({count, std::size_t(chunkLeft), inputEnd - inputPos});
+    const unsigned char* data = input.data() + inputPos;
+    chunkCrc = lodepng_update_crc32(chunkCrc, data, count);
+    inputPos += count;
+    chunkLeft -= std::uint32_t(count);
+    return data;
+}
+
+
+/**
+ * @brief Skips what is left of the current chunk and checks its CRC.
+ */
+bool PngStreamReader::endChunk() {
+    while (chunkLeft > 0 && !error) {
+        std::size_t count = chunkLeft;
+        takeChunkData(count);
+    }
+    unsigned char crc[4];
+    if (!error && !readRaw(crc, 4))
+        error = 30;
+    if (!error && !state.decoder.ignore_crc && readBigEndian(crc) != chunkCrc)
+        error = 57; // invalid CRC
+    inChunk = false;
+    return !error;
+}
+
+
+/**
+ * @brief Ends the current chunk and reads the header of the next one. PLTE
+ * and tRNS are read whole, into state.
+ *
+ * @return False on an error.
+ */
+bool PngStreamReader::nextChunk() {
+    if (inChunk && !endChunk())
+        return false;
+    unsigned char head[8];
+    if (!readRaw(head, 8)) {
+        error = 30;
+        return false;
+    }
+    chunkLeft = readBigEndian(head);
+    if (chunkLeft > 2147483647u) {
+        error = 63;
+        return false;
+    }
+    memcpy(chunkType, head + 4, 4);
+    chunkCrc = lodepng_crc32(head + 4, 4);
+    inChunk = true;
+    if (!isChunk("PLTE") && !isChunk("tRNS"))
+        return true;
+
+    if (chunkLeft > MAX_PALETTE_CHUNK) {
+        error = isChunk("PLTE") ? 38 : 39;
+        return false;
+    }
+    std::vector<unsigned char> chunk(12 + chunkLeft);
+    memcpy(chunk.data(), head, 8);
+    if (!readRaw(chunk.data() + 8, chunkLeft + 4)) {
+        error = 30;
+        return false;
+    }
+    chunkLeft = 0;
+    inChunk = false;
+    error = lodepng_inspect_chunk(&state, 0, chunk.data(), chunk.size());
+    return !error;
+}
+
+
+bool PngStreamReader::isChunk(const char* type) const {
+    return memcmp(chunkType, type, 4) == 0;
+}
+
+
+/**
+ * @brief Passes up to size more bytes of the IDAT chunks to the zlib stream.
+ *
+ * @return False once the image data is used up, or on an error.
+ */
+bool PngStreamReader::feedData(std::size_t size) {
+    bool fed = false;
+    while (size > 0 && !error && isChunk("IDAT")) {
+        if (chunkLeft == 0) {
+            nextChunk();
+            continue;
+        }
+        std::size_t count = size;
+        const unsigned char* data = takeChunkData(count);
+        if (count > 0)
+            error = lodepng_zlib_stream_feed(&zlib, data, count);
+        size -= count;
+        fed = true;
+    }
+    return fed && !error;
+}
+
+
+/**
+ * @brief Decodes the next deflate block. If the input ends inside it, reads
+ * at least as much again as is waiting, so that a block larger than the
+ * lookahead is not decoded many times over.
+ */
+bool PngStreamReader::inflateStep() {
+    std::size_t waiting = zlib.insize - zlib.bp / 8;
+    if (waiting < LOOKAHEAD / 2 && !dataEnded)
+        dataEnded = !feedData(LOOKAHEAD - waiting);
+    if (!error)
+        error = lodepng_zlib_stream_inflate(&zlib, dataEnded);
+    if (!error && zlib.starved) {
+        waiting = zlib.insize - zlib.bp / 8;
+        dataEnded = !feedData(std::max(LOOKAHEAD, waiting));
+    }
+    return !error;
+}
+
+
+/**
+ * @brief Decodes the next rows as RGBA8. Rows past the last one are left
+ * untouched.
+ *
+ * @param rgba Where the first row goes, e.g. a mapped pixel buffer.
+ * @param count Number of rows.
+ * @param stride Distance between rows in bytes, 0 for tightly packed rows.
+ * @return 0 on success or a lodepng error code.
+ */
+unsigned PngStreamReader::readRows(unsigned char* rgba, unsigned count,
+                                   std::size_t stride) {
+    if (!file)
+        return error ? error : 48;
+    if (stride == 0)
+        stride = std::size_t(width) * 4;
+    count = std::min(count, height - rowsRead);
+    const LodePNGColorMode rgbaMode = lodepng_color_mode_make(LCT_RGBA, 8);
+    for (unsigned y = 0; y < count && !error; ++y) {
+        while (zlib.outsize - zlib.outpos < lineSize + 1 && !error) {
+            if (zlib.done)
+                error = 91; // the stream ended before the image
+            else
+                inflateStep();
+        }
+        if (error)
+            break;
+        // the filter type, then the line
+        const unsigned char* scanline = zlib.out + zlib.outpos;
+        zlib.outpos += lineSize + 1;
+        error = lodepng_unfilter_scanline(
+            line.data(), scanline + 1,
+            rowsRead > 0 ? previousLine.data() : nullptr, pixelBytes,
+            scanline[0], lineSize);
+        if (error)
+            break;
+        unsigned char* out = rgba + y * stride;
+        error = lodepng_convert(out, line.data(), &rgbaMode,
+                                &state.info_png.color, width, 1);
+        if (error)
+            break;
+        if (!keepAlpha)
+            for (unsigned x = 0; x < width; ++x)
+                out[4 * x + 3] = 255;
+        line.swap(previousLine);
+        ++rowsRead;
+    }
+    return error;
+}
+
+
+/**
+ * @brief Closes the file. If every row was read, the zlib stream is read to
+ * its end and its adler32 checked, then the chunks up to IEND for their CRCs.
+ *
+ * @return 0, or the first error of the decode.
+ */
+unsigned PngStreamReader::close() {
+    if (file && !error && rowsRead == height) {
+        while (!error && !zlib.done && zlib.outpos == zlib.outsize)
+            inflateStep();
+        if (!error && zlib.outpos != zlib.outsize)
+            error = 91; // more data than the image needs
+        while (!error && !isChunk("IEND"))
+            nextChunk();
+        if (!error)
+            endChunk();
+    }
+    if (file)
+        fclose(file);
+    file = nullptr;
+    lodepng_zlib_stream_cleanup(&zlib);
+    return error;
+}
+
+
+/**
+ * @brief Decodes a whole PNG file to RGBA8, streaming it if possible and with
+ * lodepng otherwise.
+ *
+ * @param rgba Receives the pixels, top row first.
+ * @param keepAlphaChannel False to make every pixel opaque.
+ * @param mipmapRoom Reserve capacity in rgba for the mip chain
+ * TextureImage::generateMipmaps() appends, so it grows in place.
+ * @return 0 on success or a lodepng error code.
+ */
+unsigned PngStreamReader::decodeFile(std::vector<unsigned char>& rgba,
+                                     unsigned& width, unsigned& height,
+                                     const std::filesystem::path& path,
+                                     const bool keepAlphaChannel,
+                                     const bool mipmapRoom) {
+    PngStreamReader reader;
+    unsigned error = reader.open(path, keepAlphaChannel);
+    if (error == UNSUPPORTED) {
+        unsigned char* data = nullptr;
+        error = lodepng_decode32_file(&data, &width, &height,
+                                      path.string().c_str());
+        if (!error) {
+            const std::size_t size = std::size_t(width) * height * 4;
+            try {
+                rgba.reserve(capacityFor(width, height, mipmapRoom));
+                rgba.assign(data, data + size);
+            } catch (const std::bad_alloc&) {
+                error = 83;
+            }
+            if (!error && !keepAlphaChannel)
+                for (std::size_t i = 3; i < size; i += 4)
+                    rgba[i] = 255;
+        }
+        free(data);
+        return error;
+    }
+    if (error)
+        return error;
+    width = reader.getWidth();
+    height = reader.getHeight();
+    try {
+        rgba.reserve(capacityFor(width, height, mipmapRoom));
+        rgba.resize(std::size_t(width) * height * 4);
+    } catch (const std::bad_alloc&) {
+        return 83;
+    }
+    error = reader.readRows(rgba.data(), height);
+    const unsigned closeError = reader.close();
+    return error ? error : closeError;
+}
@@ -0,0 +1,90 @@
+#ifndef PNGSTREAMREADER_H
+#define PNGSTREAMREADER_H
+
+
+#include "lodepng.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <vector>
+
+
+/**
+ * @class PngStreamReader
+ * @brief Decodes a PNG a batch of rows at a time, straight into memory given
+ * by the caller.
+ *
+ * The file is read through a small buffer and its IDAT stream is inflated a
+ * deflate block at a time by lodepng_zlib_stream_inflate, so only the 32 KiB
+ * window, the block being decoded and two scanlines are kept. Rows are
+ * unfiltered and converted to RGBA8 by lodepng as they are written to the
+ * caller's memory, which can be the final image, a mapped pixel buffer object
+ * or a band of a larger image. The peak memory of a decode is therefore the
+ * output plus a few hundred kilobytes, where lodepng_decode32_file holds the
+ * whole file, the whole inflated stream and the image at once.
+ *
+ * Every non-interlaced image is streamed. For Adam7 images open() returns
+ * UNSUPPORTED; decodeFile() hands those to lodepng instead. The CRC of every
+ * chunk is checked, and the adler32 of the zlib stream by close(), which also
+ * reads the chunks up to IEND. Errors are lodepng error codes, readable with
+ * lodepng_error_text().
+ */
+class PngStreamReader {
+
+    FILE* file = nullptr;
+    unsigned width = 0;
+    unsigned height = 0;
+    unsigned rowsRead = 0;
+    bool keepAlpha = true;
+    LodePNGState state; // header, palette and colour key of the image
+    std::size_t lineSize = 0;   // bytes of a scanline without the filter type
+    std::size_t pixelBytes = 1; // distance to the left neighbour of a byte
+    std::vector<unsigned char> line, previousLine;
+    unsigned error = 0;
+
+    // file input, and the chunk being read
+    std::vector<unsigned char> input;
+    std::size_t inputPos = 0, inputEnd = 0;
+    char chunkType[5] = {};
+    std::uint32_t chunkLeft = 0; // data bytes not read yet
+    unsigned chunkCrc = 0;
+    bool inChunk = false; // its CRC is still to be read
+    bool dataEnded = false;
+
+    LodePNGZlibStream zlib;
+
+    bool fillInput();
+    bool readRaw(unsigned char* out, std::size_t size);
+    const unsigned char* takeChunkData(std::size_t& count);
+    bool endChunk();
+    bool nextChunk();
+    [[nodiscard]] bool isChunk(const char* type) const;
+    bool feedData(std::size_t size);
+    bool inflateStep();
+
+  public:
+    static constexpr unsigned UNSUPPORTED = 1; // decode with lodepng instead
+
+    PngStreamReader();
+    PngStreamReader(const PngStreamReader&) = delete;
+    PngStreamReader& operator=(const PngStreamReader&) = delete;
+    ~PngStreamReader();
+
+    unsigned open(const std::filesystem::path& path, bool keepAlpha = true);
+    unsigned readRows(unsigned char* rgba, unsigned count,
+                      std::size_t stride = 0);
+    unsigned close();
+
+    [[nodiscard]] unsigned getWidth() const { return width; }
+    [[nodiscard]] unsigned getHeight() const { return height; }
+    [[nodiscard]] unsigned getRowsRead() const { return rowsRead; }
+
+    static unsigned decodeFile(std::vector<unsigned char>& rgba,
+                               unsigned& width, unsigned& height,
+                               const std::filesystem::path& path,
+                               bool keepAlpha = true,
+                               bool mipmapRoom = false);
+};
+
+#endif
@@ -0,0 +1,155 @@
+
+
+#include "PngStreamWriter.h"
+#include "PngEncoder.h"
+#include "lodepng.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+
+namespace {
+
+constexpr size_t windowSize = 32768;
+
+void putBigEndian(unsigned char* out, const unsigned value) {
+    out[0] = static_cast<unsigned char>(value >> 24);
+    out[1] = static_cast<unsigned char>(value >> 16);
+    out[2] = static_cast<unsigned char>(value >> 8);
+    out[3] = static_cast<unsigned char>(value);
+}
+
+} // namespace
+
+
+PngStreamWriter::~PngStreamWriter() {
+    if (file)
+        fclose(file);
+}
+
+
+/**
+ * @brief Creates the file and writes the PNG signature and header.
+ *
+ * @param path The output file.
+ * @param imageWidth Width of the image in pixels.
+ * @param imageHeight Height of the image in pixels.
+ * @return True on success.
+ */
+bool PngStreamWriter::open(const std::filesystem::path& path,
+                           const unsigned imageWidth,
+                           const unsigned imageHeight) {
+    file = fopen(path.string().c_str(), "wb");
+    if (!file)
+        return false;
+    width = imageWidth;
+    height = imageHeight;
+    rowsWritten = 0;
+    adler = 1;
+    previousRow.assign(static_cast<size_t>(width) * 4, 0);
+    stream.clear();
+    dictionarySize = 0;
+
+    static const unsigned char signature[8] = {137, 80, 78, 71,
+                                               13,  10, 26, 10};
+    unsigned char header[13];
+    putBigEndian(header, width);
+    putBigEndian(header + 4, height);
+    header[8] = 8;  // bit depth
+    header[9] = 6;  // RGBA
+    header[10] = 0; // deflate
+    header[11] = 0; // adaptive filtering
+    header[12] = 0; // no interlace
+    static const unsigned char zlibHeader[2] = {0x78, 0x01};
+    return fwrite(signature, 1, 8, file) == 8 &&
+           writeChunk("IHDR", header, sizeof(header)) &&
+           writeChunk("IDAT", zlibHeader, 2);
+}
+
+
+/**
+ * @brief Writes one chunk with its length and CRC.
+ */
+bool PngStreamWriter::writeChunk(const char* type, const unsigned char* data,
+                                 const size_t size) {
+    unsigned char head[8];
+    putBigEndian(head, static_cast<unsigned>(size));
+    memcpy(head + 4, type, 4);
+    // the CRC covers the type and the data
+    std::vector<unsigned char> crcInput(head + 4, head + 8);
+    crcInput.insert(crcInput.end(), data, data + size);
+    unsigned char crc[4];
+    putBigEndian(crc, lodepng_crc32(crcInput.data(), crcInput.size()));
+    return fwrite(head, 1, 8, file) == 8 &&
+           fwrite(data, 1, size, file) == size && fwrite(crc, 1, 4, file) == 4;
+}
+
+
+/**
+ * @brief Appends a filtered scanline to the stream.
+ */
+void PngStreamWriter::filterRow(const unsigned char* row) {
+    const size_t size = static_cast<size_t>(width) * 4;
+    const size_t offset = stream.size();
+    stream.resize(offset + 1 + size);
+    PngEncoder::filterRow(row, previousRow.data(), size,
+                          stream.data() + offset, scratch);
+    memcpy(previousRow.data(), row, size);
+}
+
+
+/**
+ * @brief Filters, compresses and writes a batch of rows.
+ *
+ * @param rows The first row, in top-to-bottom order, RGBA8.
+ * @param count Number of rows in the batch.
+ * @param stride Distance between rows in bytes, 0 for tightly packed rows.
+ * @return True on success.
+ */
+bool PngStreamWriter::writeRows(const unsigned char* rows,
+                                const unsigned count, size_t stride) {
+    if (!file || rowsWritten + count > height)
+        return false;
+    if (stride == 0)
+        stride = static_cast<size_t>(width) * 4;
+    for (unsigned y = 0; y < count; ++y)
+        filterRow(rows + y * stride);
+    rowsWritten += count;
+
+    adler = lodepng_update_adler32(adler, stream.data() + dictionarySize,
+                                   stream.size() - dictionarySize);
+    LodePNGCompressSettings settings;
+    lodepng_compress_settings_init(&settings);
+    unsigned char* out = nullptr;
+    size_t outSize = 0;
+    const unsigned error =
+        lodepng_deflate_chunk(&out, &outSize, stream.data(), dictionarySize,
+                              stream.size(), &settings, 0);
+    const bool ok = !error && writeChunk("IDAT", out, outSize);
+    free(out);
+
+    // keep the end of this batch as the dictionary of the next one
+    const size_t keep = std::min(stream.size(), windowSize);
+    stream.erase(stream.begin(), stream.end() - static_cast<long>(keep));
+    dictionarySize = keep;
+    return ok;
+}
+
+
+/**
+ * @brief Ends the compressed stream, writes the trailer and closes the file.
+ *
+ * @return True if every row was written and the file was closed cleanly.
+ */
+bool PngStreamWriter::close() {
+    if (!file)
+        return false;
+    // final empty fixed Huffman block, then the adler32 of the raw data
+    unsigned char tail[6] = {0x03, 0x00};
+    putBigEndian(tail + 2, adler);
+    bool ok = rowsWritten == height && writeChunk("IDAT", tail, sizeof(tail)) &&
+              writeChunk("IEND", nullptr, 0);
+    ok = fclose(file) == 0 && ok;
+    file = nullptr;
+    return ok;
+}
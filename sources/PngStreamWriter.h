@@ -0,0 +1,48 @@
+#ifndef PNGSTREAMWRITER_H
+#define PNGSTREAMWRITER_H
+
+
+#include <cstdio>
+#include <filesystem>
+#include <vector>
+
+
+/**
+ * @class PngStreamWriter
+ * @brief Writes an RGBA8 PNG incrementally, a batch of rows at a time.
+ *
+ * Rows are filtered as they arrive and compressed with
+ * lodepng_deflate_chunk(), primed with the last 32 KiB of the previous batch
+ * and ended with a sync flush. Each batch is written as its own IDAT chunk,
+ * so memory use is bounded by the largest batch, not by the image size. The
+ * result is a standard, non-interlaced PNG.
+ */
+class PngStreamWriter {
+
+    FILE* file = nullptr;
+    unsigned width = 0;
+    unsigned height = 0;
+    unsigned rowsWritten = 0;
+    unsigned adler = 1;
+    std::vector<unsigned char> previousRow;
+    std::vector<unsigned char> scratch; // filter candidates
+    std::vector<unsigned char> stream; // dictionary followed by new data
+    size_t dictionarySize = 0;
+
+    bool writeChunk(const char* type, const unsigned char* data, size_t size);
+    void filterRow(const unsigned char* row);
+
+  public:
+    PngStreamWriter() = default;
+    PngStreamWriter(const PngStreamWriter&) = delete;
+    PngStreamWriter& operator=(const PngStreamWriter&) = delete;
+    ~PngStreamWriter();
+
+    bool open(const std::filesystem::path& path, unsigned width,
+              unsigned height);
+    bool writeRows(const unsigned char* rows, unsigned count,
+                   size_t stride = 0);
+    bool close();
+};
+
+#endif
@@ -43,19 +43,14 @@ vec3 PointCollection::findNearestPoint(const vec3 p) const {
 
 
 /**
- * @brief Draws the points in the collection.
+ * @brief Adds the points in the collection to a set of point sprites.
  *
- * This method creates a Geometry object, sets its vertex data to the points
- * in the collection, and then draws it using a GPU program. The points are
- * rendered as red dots on the screen.
+ * The points are rendered as round red dots, 10 pixels across, at the next
+ * draw of the sprites.
+ *
+ * @param sprites The sprites to add the points to.
  */
-void PointCollection::draw(GPUProgram* prog) const {
-    if (points.empty())
-        return;
-
-    Geometry<vec3> geom;
-    geom.Vtx() = points;
-    geom.updateGPU();
-    glPointSize(10.0f);
-    geom.Draw(prog, GL_POINTS, vec3(1, 0, 0)); // Red
+void PointCollection::submit(PointSprites& sprites) const {
+    for (const auto& p : points)
+        sprites.add(p, 10.0f, vec4(1, 0, 0, 1)); // Red
 }
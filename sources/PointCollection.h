@@ -3,6 +3,7 @@
 
 
 #include "Line.h"
+#include "PointSprites.h"
 #include <vector>
 
 
@@ -23,7 +24,7 @@ class PointCollection {
   public:
     void addPoint(vec3 p);
     [[nodiscard]] vec3 findNearestPoint(vec3 p) const;
-    void draw(GPUProgram* prog) const;
+    void submit(PointSprites& sprites) const;
 };
 
 #endif
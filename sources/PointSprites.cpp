@@ -0,0 +1,112 @@
+
+
+#include "PointSprites.h"
+#include <algorithm>
+
+
+namespace {
+
+// the quad of an instance is a strip of its four corners, by gl_VertexID
+const char* const vertexShaderSource = R"(
+    #version 330 core
+    layout(location = 0) in vec3 position;
+    layout(location = 1) in float size;
+    layout(location = 2) in vec4 colour;
+    uniform mat4 view;
+    uniform vec2 viewport; // in pixels
+    out vec2 local; // pixels from the centre
+    flat out float radius;
+    flat out vec4 spriteColour;
+
+    void main() {
+        vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1) * 2.0 - 1.0;
+        radius = size * 0.5;
+        local = corner * (radius + 1.0); // room for the soft edge
+        vec4 centre = view * vec4(position, 1.0);
+        gl_Position =
+            centre + vec4(local * 2.0 / viewport * centre.w, 0.0, 0.0);
+        spriteColour = colour;
+    }
+)";
+
+const char* const fragmentShaderSource = R"(
+    #version 330 core
+    in vec2 local;
+    flat in float radius;
+    flat in vec4 spriteColour;
+    out vec4 fragmentColour;
+
+    void main() {
+        // signed distance to the circle, one pixel wide ramp across it
+        float coverage = clamp(radius - length(local) + 0.5, 0.0, 1.0);
+        if (coverage == 0.0)
+            discard;
+        fragmentColour = vec4(spriteColour.rgb, spriteColour.a * coverage);
+    }
+)";
+
+std::uint8_t unorm8(float value) {
+    return std::uint8_t(std::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+}
+
+} // namespace
+
+
+PointSprites::PointSprites()
+    : program(vertexShaderSource, fragmentShaderSource) {}
+
+
+/**
+ * @brief Appends a point. It reaches the GPU at the next draw().
+ *
+ * @param position Position, transformed by the view matrix of draw().
+ * @param size Diameter in pixels.
+ * @param colour RGBA colour, stored with 8 bits per channel.
+ */
+void PointSprites::add(const vec3& position, float size, const vec4& colour) {
+    instances.Vtx().push_back({position,
+                               size,
+                               {unorm8(colour.x), unorm8(colour.y),
+                                unorm8(colour.z), unorm8(colour.w)}});
+    dirty = true;
+}
+
+
+/**
+ * @brief Removes every point; the instance buffer is kept for reuse.
+ */
+void PointSprites::clear() {
+    instances.Vtx().clear();
+    dirty = true;
+}
+
+
+std::size_t PointSprites::size() const { return instances.Vtx().size(); }
+
+
+/**
+ * @brief Draws every point, blended over the framebuffer.
+ *
+ * @param view The transform applied to the positions.
+ */
+void PointSprites::draw(const mat4& view) {
+    const std::size_t count = instances.Vtx().size();
+    if (count == 0)
+        return;
+    if (dirty) {
+        instances.updateGPU();
+        dirty = false;
+    }
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+
+    GLState& state = GLState::instance();
+    program.Use();
+    program.setUniform(view, "view");
+    program.setUniform(vec2(float(viewport[2]), float(viewport[3])),
+                       "viewport");
+    state.enable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    instances.DrawInstanced(GL_TRIANGLE_STRIP, 4, (int)count);
+    state.disable(GL_BLEND);
+}
@@ -0,0 +1,66 @@
+#ifndef POINTSPRITES_H
+#define POINTSPRITES_H
+
+
+#include "framework.h"
+#include <cstddef>
+#include <cstdint>
+
+
+/**
+ * @brief One point of PointSprites: 20 bytes of instance data.
+ */
+struct PointSprite {
+    vec3 position;
+    float size; // diameter in pixels
+    std::uint8_t colour[4]; // RGBA
+};
+
+template <>
+struct VertexFormat<PointSprite> {
+    static constexpr VertexAttribute attributes[] = {
+        vertexAttribute<decltype(PointSprite::position)>(
+            0, offsetof(PointSprite, position)),
+        vertexAttribute<decltype(PointSprite::size)>(
+            1, offsetof(PointSprite, size)),
+        vertexAttribute<decltype(PointSprite::colour)>(
+            2, offsetof(PointSprite, colour), true)};
+    static constexpr GLuint divisor = 1; // one sprite per instance
+};
+
+
+/**
+ * @class PointSprites
+ * @brief Draws round, antialiased points of any size and colour with one
+ * instanced draw call.
+ *
+ * Every point is an instance: its position, size and colour are read from an
+ * instance buffer, and the vertex shader expands it into a quad of its size
+ * in pixels, one pixel wider for the soft edge. The fragment shader computes
+ * the distance to the circle and turns it into coverage, which is blended
+ * over the framebuffer. Unlike glPointSize and GL_POINT_SMOOTH, which a core
+ * profile ignores or limits to driver-specific sizes, this looks the same on
+ * every driver, and a point whose centre is just outside the viewport still
+ * shows its visible part.
+ *
+ * Sizes are in framebuffer pixels, taken from the viewport at draw(), so
+ * poster tiles show the points at the size they have on the screen. Like
+ * Geometry, the sprites must be used on the thread that owns the GL context.
+ */
+class PointSprites {
+
+    Geometry<PointSprite> instances;
+    GPUProgram program;
+    bool dirty = false;
+
+  public:
+    PointSprites();
+
+    void add(const vec3& position, float size, const vec4& colour);
+    void clear();
+    void draw(const mat4& view);
+
+    [[nodiscard]] std::size_t size() const;
+};
+
+#endif
@@ -0,0 +1,183 @@
+
+
+#include "RenderQueue.h"
+#include <algorithm>
+
+
+namespace {
+
+// Fields of a sort key, from the most significant bit down
+constexpr unsigned LAYER_SHIFT = 60, LAYER_BITS = 4;
+constexpr unsigned PROGRAM_SHIFT = 50, PROGRAM_BITS = 10;
+constexpr unsigned PRIMITIVE_SHIFT = 46, PRIMITIVE_BITS = 4;
+constexpr unsigned TEXTURE_SHIFT = 32, TEXTURE_BITS = 14;
+constexpr unsigned SIZE_SHIFT = 24, SIZE_BITS = 8;
+constexpr unsigned COLOUR_SHIFT = 0, COLOUR_BITS = 24;
+
+std::uint32_t field(std::uint64_t key, unsigned shift, unsigned bits) {
+    return std::uint32_t((key >> shift) & ((std::uint64_t(1) << bits) - 1));
+}
+
+/**
+ * @brief Returns the index of value in table, appending it if it is new.
+ */
+template <typename T>
+std::uint64_t indexOf(std::vector<T>& table, const T& value) {
+    const auto found = std::find(table.begin(), table.end(), value);
+    if (found != table.end())
+        return std::uint64_t(found - table.begin());
+    table.push_back(value);
+    return table.size() - 1;
+}
+
+/**
+ * @brief Whether consecutive draws of a primitive can be joined into one.
+ * Strips and loops would connect the last vertex of one to the next.
+ */
+bool isList(GLenum primitive) {
+    return primitive == GL_POINTS || primitive == GL_LINES ||
+           primitive == GL_TRIANGLES;
+}
+
+} // namespace
+
+
+/**
+ * @brief Records a draw for the next flush().
+ *
+ * @param draw Layer and state to draw with.
+ * @param vertices The vertices, copied at once.
+ * @param count Number of vertices.
+ */
+void RenderQueue::submit(const Draw& draw, const vec3* vertices,
+                         std::size_t count) {
+    if (count == 0)
+        return;
+    // a full table would make keys ambiguous: draw what is queued first
+    if (programs.size() >= (1u << PROGRAM_BITS) ||
+        textures.size() >= (1u << TEXTURE_BITS) ||
+        sizes.size() >= (1u << SIZE_BITS) ||
+        colours.size() >= (1u << COLOUR_BITS) ||
+        staging.size() + count > UINT32_MAX)
+        flush();
+
+    const vec3& colour = draw.colour;
+    const auto colourKey = std::make_tuple(colour.x, colour.y, colour.z);
+    auto colourSlot = colourIndex.find(colourKey);
+    if (colourSlot == colourIndex.end()) {
+        colourSlot =
+            colourIndex.emplace(colourKey, (std::uint32_t)colours.size())
+                .first;
+        colours.push_back(colour);
+    }
+    const std::uint64_t key =
+        std::uint64_t(std::min(draw.layer, (1u << LAYER_BITS) - 1))
+            << LAYER_SHIFT |
+        indexOf(programs, draw.program) << PROGRAM_SHIFT |
+        std::uint64_t(draw.primitive & 0xf) << PRIMITIVE_SHIFT |
+        indexOf(textures, draw.texture) << TEXTURE_SHIFT |
+        indexOf(sizes, draw.size) << SIZE_SHIFT |
+        std::uint64_t(colourSlot->second) << COLOUR_SHIFT;
+    commands.push_back({key, (std::uint32_t)staging.size(),
+                        (std::uint32_t)count});
+    staging.insert(staging.end(), vertices, vertices + count);
+}
+
+
+/**
+ * @brief Sorts the commands by key, least significant byte first. A byte in
+ * which every key agrees is skipped, so a frame with few distinct states
+ * takes only a few passes. Equal keys keep their submission order.
+ */
+void RenderQueue::radixSort() {
+    sorted.resize(commands.size());
+    for (unsigned shift = 0; shift < 64; shift += 8) {
+        std::size_t counts[256] = {};
+        for (const Command& command : commands)
+            ++counts[(command.key >> shift) & 0xff];
+        if (counts[(commands[0].key >> shift) & 0xff] == commands.size())
+            continue;
+        std::size_t offset = 0;
+        for (std::size_t& bucket : counts) {
+            const std::size_t size = bucket;
+            bucket = offset;
+            offset += size;
+        }
+        for (const Command& command : commands)
+            sorted[counts[(command.key >> shift) & 0xff]++] = command;
+        commands.swap(sorted);
+    }
+}
+
+
+/**
+ * @brief Draws every queued command, sorted and merged, and empties the
+ * queue.
+ */
+void RenderQueue::flush() {
+    commandCount = commands.size();
+    drawCalls = 0;
+    if (!commands.empty()) {
+        radixSort();
+
+        struct Run {
+            std::uint64_t key;
+            std::uint32_t first, count;
+        };
+        std::vector<Run> runs;
+        std::vector<vec3>& vertices = geometry.Vtx();
+        vertices.clear();
+        vertices.reserve(staging.size());
+        for (const Command& command : commands) {
+            const GLenum primitive =
+                field(command.key, PRIMITIVE_SHIFT, PRIMITIVE_BITS);
+            if (!runs.empty() && runs.back().key == command.key &&
+                isList(primitive))
+                runs.back().count += command.count;
+            else
+                runs.push_back({command.key, (std::uint32_t)vertices.size(),
+                                command.count});
+            vertices.insert(vertices.end(), staging.begin() + command.first,
+                            staging.begin() + command.first + command.count);
+        }
+        geometry.updateGPU();
+
+        GLState& state = GLState::instance();
+        const Run* previous = nullptr;
+        for (const Run& run : runs) {
+            GPUProgram* program =
+                programs[field(run.key, PROGRAM_SHIFT, PROGRAM_BITS)];
+            const GLenum primitive =
+                field(run.key, PRIMITIVE_SHIFT, PRIMITIVE_BITS);
+            const Texture* texture =
+                textures[field(run.key, TEXTURE_SHIFT, TEXTURE_BITS)];
+            const float size = sizes[field(run.key, SIZE_SHIFT, SIZE_BITS)];
+            const std::uint32_t colour =
+                field(run.key, COLOUR_SHIFT, COLOUR_BITS);
+            program->Use();
+            if (texture)
+                texture->Bind(0);
+            if (primitive == GL_POINTS)
+                state.setPointSize(size);
+            else if (primitive != GL_TRIANGLES)
+                state.setLineWidth(size);
+            // the colour only needs setting again after a program change
+            if (!previous ||
+                field(previous->key, PROGRAM_SHIFT, PROGRAM_BITS) !=
+                    field(run.key, PROGRAM_SHIFT, PROGRAM_BITS) ||
+                field(previous->key, COLOUR_SHIFT, COLOUR_BITS) != colour)
+                program->setUniform(colours[colour], "color");
+            geometry.DrawRange((int)primitive, (int)run.first,
+                               (int)run.count);
+            ++drawCalls;
+            previous = &run;
+        }
+    }
+    commands.clear();
+    staging.clear();
+    programs.clear();
+    textures.clear();
+    sizes.clear();
+    colourIndex.clear();
+    colours.clear();
+}
@@ -0,0 +1,79 @@
+#ifndef RENDERQUEUE_H
+#define RENDERQUEUE_H
+
+
+#include "framework.h"
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <tuple>
+#include <vector>
+
+
+/**
+ * @class RenderQueue
+ * @brief Collects the draws of a frame and issues them sorted by state, with
+ * compatible draws merged.
+ *
+ * submit() records a command instead of drawing: its vertices are appended to
+ * a staging array, and its layer and state (program, primitive type,
+ * texture, point size or line width, colour) are packed into a 64-bit sort
+ * key. Each state value is replaced by its index in a small table for the
+ * frame, so keys are exact and equal keys mean equal state. The layer is the
+ * most significant field: lower layers are drawn first, so the painter's
+ * order of layers holds, while the order within a layer is free.
+ *
+ * flush() sorts the commands by key with a stable radix sort, skipping the
+ * byte positions in which all keys agree, and copies their vertices to one
+ * buffer in that order. Runs of commands with the same key and a list
+ * primitive (points, lines or triangles) become a single glDrawArrays call;
+ * every state is set once per run, through GLState. The number of state
+ * changes and draw calls is therefore the minimum for the set of commands,
+ * whatever order they were submitted in.
+ *
+ * The queue must be used on the thread that renders.
+ */
+class RenderQueue {
+
+    struct Command {
+        std::uint64_t key;
+        std::uint32_t first, count; // in the staging vertices
+    };
+
+    std::vector<Command> commands, sorted;
+    std::vector<vec3> staging;
+    Geometry<vec3> geometry; // vertices of every command, in sorted order
+
+    std::vector<GPUProgram*> programs;
+    std::vector<const Texture*> textures;
+    std::vector<float> sizes;
+    std::map<std::tuple<float, float, float>, std::uint32_t> colourIndex;
+    std::vector<vec3> colours;
+
+    std::size_t drawCalls = 0, commandCount = 0;
+
+    void radixSort();
+
+  public:
+    /**
+     * @brief State of a command. The program must have a vec3 uniform
+     * "color"; size is the point size of GL_POINTS and the line width of
+     * lines; the texture, if any, is bound to unit 0.
+     */
+    struct Draw {
+        GPUProgram* program;
+        GLenum primitive;
+        vec3 colour;
+        float size = 1.0f;
+        const Texture* texture = nullptr;
+        unsigned layer = 0; // 0 to 15
+    };
+
+    void submit(const Draw& draw, const vec3* vertices, std::size_t count);
+    void flush();
+
+    [[nodiscard]] std::size_t getDrawCalls() const { return drawCalls; }
+    [[nodiscard]] std::size_t getCommandCount() const { return commandCount; }
+};
+
+#endif
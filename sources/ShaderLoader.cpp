@@ -0,0 +1,388 @@
+
+
+#include "ShaderLoader.h"
+#include "MappedFile.h"
+#include <algorithm>
+#include <stdio.h>
+
+namespace fs = std::filesystem;
+
+
+namespace {
+
+/**
+ * @brief Returns the line without leading blanks, including the carriage
+ * return that ends a blank CRLF line.
+ */
+std::string_view trimLeft(std::string_view line) {
+    const std::size_t first = line.find_first_not_of(" \t\r");
+    return first == std::string_view::npos ? std::string_view{}
+                                           : line.substr(first);
+}
+
+
+/**
+ * @brief Parses the file name of an `#include "name"` or `#include <name>`
+ * directive.
+ *
+ * @param line A source line.
+ * @param name Receives the included file name on success.
+ * @return True if the line is an include directive.
+ */
+bool parseInclude(std::string_view line, std::string_view& name) {
+    line = trimLeft(line);
+    if (line.empty() || line.front() != '#')
+        return false;
+    line = trimLeft(line.substr(1));
+    if (!line.starts_with("include"))
+        return false;
+    line = trimLeft(line.substr(7));
+    if (line.empty() || (line.front() != '"' && line.front() != '<'))
+        return false;
+    const char close = line.front() == '"' ? '"' : '>';
+    const std::size_t end = line.find(close, 1);
+    if (end == std::string_view::npos)
+        return false;
+    name = line.substr(1, end - 1);
+    return true;
+}
+
+} // namespace
+
+
+/**
+ * @brief Returns the loader shared by all GPUProgram instances.
+ */
+ShaderLoader& ShaderLoader::instance() {
+    static ShaderLoader loader;
+    return loader;
+}
+
+
+/**
+ * @brief Computes the 64-bit FNV-1a hash of a string.
+ *
+ * @param text The bytes to hash.
+ * @param seed The initial hash value, used to chain several strings.
+ * @return The hash value.
+ */
+std::uint64_t ShaderLoader::hash(const std::string_view text,
+                                 std::uint64_t seed) {
+    for (const char c : text) {
+        seed ^= static_cast<unsigned char>(c);
+        seed *= 1099511628211ull;
+    }
+    return seed;
+}
+
+
+/**
+ * @brief Registers a directory that is searched for included files.
+ *
+ * @param directory The include directory.
+ */
+void ShaderLoader::addIncludePath(const fs::path& directory) {
+    std::lock_guard lock(mutex);
+    includePaths.push_back(directory);
+}
+
+
+/**
+ * @brief Drops every cached file and expansion.
+ */
+void ShaderLoader::clear() {
+    std::lock_guard lock(mutex);
+    files.clear();
+    expansions.clear();
+    roots.clear();
+    failures.clear();
+}
+
+
+/**
+ * @brief Returns the cached content of a file, reading it only if it is new
+ * or has changed on disk since it was last read.
+ *
+ * @param path The file to fetch.
+ * @return The cached file or nullptr if it cannot be read.
+ */
+const ShaderLoader::SourceFile* ShaderLoader::fetch(const fs::path& path) {
+    std::error_code ec;
+    const auto mtime = fs::last_write_time(path, ec);
+    if (ec)
+        return nullptr;
+    const auto size = fs::file_size(path, ec);
+    if (ec)
+        return nullptr;
+
+    SourceFile& file = files[path.lexically_normal().string()];
+    if (file.hash != 0 && file.mtime == mtime && file.size == size)
+        return &file;
+
+    const MappedFile mapped(path);
+    if (!mapped.isOpen()) {
+        files.erase(path.lexically_normal().string());
+        return nullptr;
+    }
+    file.text.assign(mapped.data(), mapped.size());
+    file.mtime = mtime;
+    file.size = size;
+    file.hash = hash(file.text);
+    return &file;
+}
+
+
+/**
+ * @brief Checks whether every file an expansion was built from still has the
+ * same content.
+ */
+bool ShaderLoader::isCurrent(const Expansion& expansion) {
+    return std::ranges::all_of(expansion.dependencies, [this](const auto& dep) {
+        const SourceFile* file = fetch(dep.first);
+        return file && file->hash == dep.second;
+    });
+}
+
+
+/**
+ * @brief Finds the file referenced by an include directive.
+ *
+ * @param from The including file.
+ * @param name The name given in the directive.
+ * @return The resolved path, or an empty path if the file does not exist.
+ */
+fs::path ShaderLoader::resolveInclude(const fs::path& from,
+                                      const std::string_view name) const {
+    std::error_code ec;
+    if (fs::path local = from.parent_path() / name; fs::exists(local, ec))
+        return local.lexically_normal();
+    for (const auto& dir : includePaths)
+        if (fs::path candidate = dir / name; fs::exists(candidate, ec))
+            return candidate.lexically_normal();
+    return {};
+}
+
+
+/**
+ * @brief Appends the expanded content of a file to an expansion.
+ *
+ * Include directives are replaced by the content of the included file,
+ * surrounded by #line directives. The GLSL source string number of a #line
+ * directive is the index of the file in @p included, so compiler logs can be
+ * mapped back to files.
+ *
+ * @param path The file to expand.
+ * @param expansion The expansion to append to.
+ * @param included Files already included in this expansion.
+ * @return False if the file or one of its includes cannot be read.
+ */
+bool ShaderLoader::expand(const fs::path& path, Expansion& expansion,
+                          std::vector<std::string>& included) {
+    const SourceFile* file = fetch(path);
+    if (!file) {
+        printf("Error while opening shader code file %s!\n",
+               path.string().c_str());
+        return false;
+    }
+    const std::string key = path.lexically_normal().string();
+    const std::size_t index = included.size();
+    included.push_back(key);
+    expansion.dependencies.emplace_back(key, file->hash);
+
+    // References into an unordered_map survive rehashing, so the text stays
+    // valid while nested includes add files to the cache.
+    const std::string& text = file->text;
+    std::string& out = expansion.text;
+    out.reserve(out.size() + text.size());
+
+    std::size_t lineNumber = 1;
+    std::size_t pos = 0;
+    while (pos < text.size()) {
+        std::size_t end = text.find('\n', pos);
+        if (end == std::string::npos)
+            end = text.size();
+        const std::string_view line(text.data() + pos, end - pos);
+
+        std::string_view name;
+        if (parseInclude(line, name)) {
+            const fs::path target = resolveInclude(path, name);
+            if (target.empty()) {
+                printf("%s(%zu): cannot find include file %.*s\n",
+                       key.c_str(), lineNumber, static_cast<int>(name.size()),
+                       name.data());
+                return false;
+            }
+            if (std::ranges::find(included, target.string()) ==
+                included.end()) {
+                out += "#line 1 " + std::to_string(included.size()) + "\n";
+                if (!expand(target, expansion, included))
+                    return false;
+                if (!out.empty() && out.back() != '\n')
+                    out += '\n';
+                out += "#line " + std::to_string(lineNumber + 1) + " " +
+                       std::to_string(index) + "\n";
+            } else {
+                out += '\n';
+            }
+        } else {
+            out.append(line);
+            out += '\n';
+        }
+        pos = end + 1;
+        ++lineNumber;
+    }
+    return true;
+}
+
+
+/**
+ * @brief Inserts #define directives right after the #version line of a
+ * shader source.
+ *
+ * Each define is given as `NAME`, `NAME VALUE` or `NAME=VALUE`, where only
+ * the first `=` separates the name, so `X=(A==B)` keeps its value. Blank
+ * lines and comments before #version are skipped. A #line directive after the
+ * injected block keeps the original line numbers.
+ *
+ * @param source The shader source.
+ * @param defines The macros to define.
+ * @return The source with the macros defined.
+ */
+std::string ShaderLoader::injectDefines(const std::string_view source,
+                                        const std::vector<std::string>& defines) {
+    if (defines.empty())
+        return std::string(source);
+
+    std::size_t insertAt = 0;
+    std::size_t nextLine = 1;
+    std::size_t pos = 0;
+    bool inComment = false; // inside a /* */ comment
+    for (std::size_t lineNumber = 1; pos < source.size(); ++lineNumber) {
+        std::size_t end = source.find('\n', pos);
+        if (end == std::string_view::npos)
+            end = source.size();
+        std::string_view line = source.substr(pos, end - pos);
+        while (true) { // drop the comments in front of the first token
+            if (inComment) {
+                const std::size_t close = line.find("*/");
+                if (close == std::string_view::npos) {
+                    line = {};
+                    break;
+                }
+                line.remove_prefix(close + 2);
+                inComment = false;
+            }
+            line = trimLeft(line);
+            if (line.starts_with("//")) {
+                line = {};
+            } else if (line.starts_with("/*")) {
+                line.remove_prefix(2);
+                inComment = true;
+                continue;
+            }
+            break;
+        }
+        if (line.starts_with("#version")) {
+            insertAt = std::min(end + 1, source.size());
+            nextLine = lineNumber + 1;
+            break;
+        }
+        if (!line.empty())
+            break;
+        pos = end + 1;
+    }
+
+    std::string block;
+    for (std::string define : defines) {
+        if (const std::size_t equals = define.find('=');
+            equals != std::string::npos)
+            define[equals] = ' ';
+        block += "#define " + define + "\n";
+    }
+    block += "#line " + std::to_string(nextLine) + " 0\n";
+
+    std::string out;
+    out.reserve(source.size() + block.size() + 1);
+    out.append(source.substr(0, insertAt));
+    if (!out.empty() && out.back() != '\n')
+        out += '\n';
+    out += block;
+    out.append(source.substr(insertAt));
+    return out;
+}
+
+
+/**
+ * @brief Loads a shader source file with its includes resolved and the given
+ * macros defined.
+ *
+ * @param path The root shader file.
+ * @param defines The macros to define, see injectDefines().
+ * @return The expanded source, or an empty string on error.
+ */
+std::string ShaderLoader::load(const fs::path& path,
+                               const std::vector<std::string>& defines) {
+    std::lock_guard lock(mutex);
+    const SourceFile* root = fetch(path);
+    if (!root) {
+        printf("Error while opening shader code file %s!\n",
+               path.string().c_str());
+        return "";
+    }
+    const std::string name = path.lexically_normal().string();
+    const std::uint64_t key =
+        hash(path.parent_path().lexically_normal().string(), root->hash);
+
+    if (const auto it = expansions.find(key);
+        it != expansions.end() && isCurrent(it->second)) {
+        roots[name] = key;
+        return injectDefines(it->second.text, defines);
+    }
+
+    Expansion expansion;
+    std::vector<std::string> included;
+    if (!expand(path, expansion, included)) {
+        // keep the last good expansion, so dependencies() still lists the
+        // files a fix may be saved to, along with the ones read this time
+        std::vector<std::string>& failed = failures[name];
+        failed.clear();
+        for (const auto& dep : expansion.dependencies)
+            failed.push_back(dep.first);
+        return "";
+    }
+    failures.erase(name);
+    if (auto& previous = roots[name]; previous != key) {
+        // the root file was edited, its old expansion is no longer reachable
+        expansions.erase(previous);
+        previous = key;
+    }
+    const auto& stored = expansions[key] = std::move(expansion);
+    return injectDefines(stored.text, defines);
+}
+
+
+/**
+ * @brief Lists the files the last expansion of a shader was built from.
+ *
+ * If the last load() failed, the files that attempt read are added, so a
+ * shader is reloaded when any file that may fix it changes.
+ *
+ * @param path The root shader file, as passed to load().
+ * @return The root file followed by every file it includes, or an empty list
+ * if the file has never been read.
+ */
+std::vector<std::string> ShaderLoader::dependencies(const fs::path& path) {
+    std::lock_guard lock(mutex);
+    const std::string name = path.lexically_normal().string();
+    std::vector<std::string> result;
+    if (const auto root = roots.find(name); root != roots.end())
+        if (const auto it = expansions.find(root->second);
+            it != expansions.end())
+            for (const auto& dep : it->second.dependencies)
+                result.push_back(dep.first);
+    if (const auto failed = failures.find(name); failed != failures.end())
+        for (const std::string& file : failed->second)
+            if (std::ranges::find(result, file) == result.end())
+                result.push_back(file);
+    return result;
+}
@@ -0,0 +1,78 @@
+#ifndef SHADERLOADER_H
+#define SHADERLOADER_H
+
+
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+
+/**
+ * @class ShaderLoader
+ * @brief Loads GLSL source files, resolves #include directives and injects
+ * #define variants.
+ *
+ * Files are read through MappedFile and kept in a cache keyed by their path.
+ * A cached file is only read again when its modification time or size
+ * changes. Fully expanded sources are cached under the content hash of their
+ * root file and stay valid as long as the content hashes of every file they
+ * include are unchanged, so recompiling a shader library costs O(size) without
+ * repeated file I/O.
+ *
+ * Include paths are resolved relative to the including file first and then
+ * against the registered include directories. Every file is included at most
+ * once per expansion, and #line directives keep compiler logs pointing at the
+ * original line numbers.
+ *
+ * All public members are thread-safe, so sources can be reloaded from a
+ * background thread.
+ */
+class ShaderLoader {
+
+    struct SourceFile {
+        std::filesystem::file_time_type mtime;
+        std::uintmax_t size = 0;
+        std::uint64_t hash = 0;
+        std::string text;
+    };
+
+    struct Expansion {
+        std::vector<std::pair<std::string, std::uint64_t>> dependencies;
+        std::string text;
+    };
+
+    std::unordered_map<std::string, SourceFile> files;
+    std::unordered_map<std::uint64_t, Expansion> expansions;
+    std::unordered_map<std::string, std::uint64_t> roots;
+    // files read by the last failed expansion of a root
+    std::unordered_map<std::string, std::vector<std::string>> failures;
+    std::vector<std::filesystem::path> includePaths;
+    std::mutex mutex;
+
+    const SourceFile* fetch(const std::filesystem::path& path);
+    bool isCurrent(const Expansion& expansion);
+    bool expand(const std::filesystem::path& path, Expansion& expansion,
+                std::vector<std::string>& included);
+    std::filesystem::path resolveInclude(const std::filesystem::path& from,
+                                         std::string_view name) const;
+
+  public:
+    static ShaderLoader& instance();
+
+    void addIncludePath(const std::filesystem::path& directory);
+    std::string load(const std::filesystem::path& path,
+                     const std::vector<std::string>& defines = {});
+    std::vector<std::string> dependencies(const std::filesystem::path& path);
+    void clear();
+
+    static std::uint64_t hash(std::string_view text,
+                              std::uint64_t seed = 14695981039346656037ull);
+    static std::string injectDefines(std::string_view source,
+                                     const std::vector<std::string>& defines);
+};
+
+#endif
@@ -0,0 +1,306 @@
+
+
+#include "ShaderWatcher.h"
+#include "framework.h"
+#include <algorithm>
+#include <unordered_set>
+
+#ifdef __linux__
+#    include <poll.h>
+#    include <sys/eventfd.h>
+#    include <sys/inotify.h>
+#    include <unistd.h>
+#endif
+
+
+namespace {
+
+/**
+ * @brief Converts a path to the absolute, normalized form used to compare
+ * watched files with inotify event names.
+ */
+std::string canonicalName(const fs::path& path) {
+    std::error_code ec;
+    const fs::path absolute = fs::absolute(path, ec);
+    return (ec ? path : absolute).lexically_normal().string();
+}
+
+} // namespace
+
+
+/**
+ * @brief Returns the watcher shared by all GPUProgram instances. It is
+ * deliberately leaked: a GPUProgram destroyed after it would otherwise
+ * unregister from a destroyed object.
+ */
+ShaderWatcher& ShaderWatcher::instance() {
+    static ShaderWatcher& watcher = *new ShaderWatcher;
+    return watcher;
+}
+
+
+/**
+ * @brief Starts watching the shader files of every registered program.
+ *
+ * @param bindContext Called on the worker thread with true to make the
+ * background GL context current and with false to release it before the
+ * thread exits. The context must share objects with the main context.
+ * @param onReload Called from the worker thread whenever a rebuilt program is
+ * waiting for applyPending(), e.g. to wake up the main loop.
+ * @return True if the worker thread is running.
+ */
+bool ShaderWatcher::start(std::function<void(bool)> bindContext,
+                          std::function<void()> onReload) {
+#ifdef __linux__
+    if (running)
+        return true;
+    inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (inotifyFd < 0 || wakeFd < 0) {
+        printf("Shader hot reload: cannot initialize inotify\n");
+        if (inotifyFd >= 0)
+            close(inotifyFd);
+        if (wakeFd >= 0)
+            close(wakeFd);
+        inotifyFd = wakeFd = -1;
+        return false;
+    }
+    notify = std::move(onReload);
+    {
+        std::lock_guard lock(mutex);
+        for (const GPUProgram* program : programs)
+            addWatches(program);
+    }
+    running = true;
+    worker = std::thread([this, bind = std::move(bindContext)] { run(bind); });
+    return true;
+#else
+    printf("Shader hot reload is only supported on Linux\n");
+    return false;
+#endif
+}
+
+
+/**
+ * @brief Stops the worker thread and drops rebuilt programs that were never
+ * applied. Must be called while the main GL context is still current.
+ */
+void ShaderWatcher::stop() {
+#ifdef __linux__
+    if (!running)
+        return;
+    running = false;
+    const uint64_t one = 1;
+    [[maybe_unused]] const ssize_t written = write(wakeFd, &one, sizeof(one));
+    worker.join();
+    close(inotifyFd);
+    close(wakeFd);
+    inotifyFd = wakeFd = -1;
+
+    std::lock_guard lock(mutex);
+    for (Pending& entry : pending)
+        discard(entry);
+    pending.clear();
+    watchedDirs.clear();
+#endif
+}
+
+
+/**
+ * @brief Registers a program whose stages were built from files.
+ *
+ * Called by GPUProgram::addShader(); calling it again for the same program
+ * only refreshes the set of watched directories.
+ *
+ * @param program The program to watch.
+ */
+void ShaderWatcher::watch(GPUProgram* program) {
+    std::lock_guard lock(mutex);
+    if (std::ranges::find(programs, program) == programs.end())
+        programs.push_back(program);
+    if (running)
+        addWatches(program);
+}
+
+
+/**
+ * @brief Unregisters a program, dropping a rebuilt version not yet applied.
+ *
+ * @param program The program that is being destroyed.
+ */
+void ShaderWatcher::unwatch(GPUProgram* program) {
+    std::lock_guard lock(mutex);
+    std::erase(programs, program);
+    std::erase_if(pending, [this, program](Pending& entry) {
+        if (entry.program != program)
+            return false;
+        discard(entry);
+        return true;
+    });
+}
+
+
+/**
+ * @brief Swaps in every rebuilt program whose GPU work has completed.
+ *
+ * Must be called on the main thread, once per frame before rendering.
+ *
+ * @return True if at least one program was replaced and the screen should be
+ * redrawn.
+ */
+bool ShaderWatcher::applyPending() {
+    std::lock_guard lock(mutex);
+    if (pending.empty())
+        return false;
+    bool applied = false;
+    std::erase_if(pending, [&applied](const Pending& entry) {
+        const GLenum status = glClientWaitSync(entry.fence, 0, 0);
+        if (status == GL_TIMEOUT_EXPIRED)
+            return false; // not finished yet, try again next frame
+        glDeleteSync(entry.fence);
+        if (status == GL_WAIT_FAILED) {
+            glDeleteProgram(entry.programId);
+            return true;
+        }
+        entry.program->replace(entry.programId, entry.shaders);
+        applied = true;
+        return true;
+    });
+    return applied;
+}
+
+
+/**
+ * @brief Releases the GL objects of a rebuilt program that will not be used.
+ */
+void ShaderWatcher::discard(Pending& entry) const {
+    const auto& stages = entry.program->Stages();
+    for (size_t i = 0; i < entry.shaders.size(); ++i)
+        if (entry.shaders[i] != stages[i].shader)
+            glDeleteShader(entry.shaders[i]);
+    glDeleteProgram(entry.programId);
+    glDeleteSync(entry.fence);
+}
+
+
+/**
+ * @brief Adds inotify watches for the directories of every file a program is
+ * built from. The caller must hold the mutex.
+ */
+void ShaderWatcher::addWatches(const GPUProgram* program) {
+#ifdef __linux__
+    for (const auto& stage : program->Stages()) {
+        for (const std::string& file :
+             ShaderLoader::instance().dependencies(stage.file)) {
+            const std::string dir =
+                fs::path(canonicalName(file)).parent_path().string();
+            // editors often save by renaming a temporary file, so watch the
+            // directory instead of the file itself
+            const int wd =
+                inotify_add_watch(inotifyFd, dir.c_str(),
+                                  IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+            if (wd >= 0)
+                watchedDirs[wd] = dir;
+        }
+    }
+#endif
+}
+
+
+/**
+ * @brief Worker thread: collects file change events and rebuilds the affected
+ * programs.
+ */
+void ShaderWatcher::run(const std::function<void(bool)>& bindContext) {
+#ifdef __linux__
+    bindContext(true);
+    alignas(inotify_event) char buffer[4096];
+    std::vector<std::string> changed;
+
+    while (running) {
+        pollfd fds[2] = {{inotifyFd, POLLIN, 0}, {wakeFd, POLLIN, 0}};
+        // block until the first event, then wait for a quiet period so that
+        // a burst of writes from one save triggers a single rebuild
+        const int timeout = changed.empty() ? -1 : 50;
+        const int ready = poll(fds, 2, timeout);
+        if (!running)
+            break;
+        if (ready == 0) {
+            reload(changed);
+            changed.clear();
+            continue;
+        }
+        if (ready < 0 || !(fds[0].revents & POLLIN))
+            continue;
+
+        ssize_t length;
+        while ((length = read(inotifyFd, buffer, sizeof(buffer))) > 0) {
+            for (char* p = buffer; p < buffer + length;) {
+                const auto* event = reinterpret_cast<inotify_event*>(p);
+                if (event->len > 0) {
+                    std::lock_guard lock(mutex);
+                    if (const auto it = watchedDirs.find(event->wd);
+                        it != watchedDirs.end())
+                        changed.push_back(
+                            (fs::path(it->second) / event->name).string());
+                }
+                p += sizeof(inotify_event) + event->len;
+            }
+        }
+    }
+    bindContext(false);
+#endif
+}
+
+
+/**
+ * @brief Rebuilds every program that depends on one of the changed files.
+ * Runs on the worker thread with the background context current.
+ */
+void ShaderWatcher::reload(const std::vector<std::string>& changedFiles) {
+    const std::unordered_set<std::string> changedSet(changedFiles.begin(),
+                                                     changedFiles.end());
+    std::lock_guard lock(mutex);
+    for (GPUProgram* program : programs) {
+        const auto& stages = program->Stages();
+        std::vector<bool> changed(stages.size(), false);
+        bool any = false;
+        for (size_t i = 0; i < stages.size(); ++i) {
+            for (const std::string& file :
+                 ShaderLoader::instance().dependencies(stages[i].file)) {
+                if (changedSet.contains(canonicalName(file))) {
+                    changed[i] = any = true;
+                    break;
+                }
+            }
+        }
+        if (!any)
+            continue;
+
+        // a rebuild that has not been applied yet is superseded, but the
+        // stages it recompiled still differ from the live program
+        if (const auto it = std::ranges::find(pending, program,
+                                              &Pending::program);
+            it != pending.end()) {
+            for (size_t i = 0; i < changed.size(); ++i)
+                changed[i] = changed[i] || it->changed[i];
+            discard(*it);
+            pending.erase(it);
+        }
+
+        std::vector<GLuint> shaders;
+        const GLuint programId = program->rebuild(changed, shaders);
+        if (!programId) {
+            printf("Shader reload failed, keeping the previous program\n");
+            continue;
+        }
+        const GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        glFlush();
+        pending.push_back({program, programId, std::move(shaders),
+                           std::move(changed), fence});
+        addWatches(program);
+        printf("Shader program reloaded\n");
+    }
+    if (!pending.empty() && notify)
+        notify();
+}
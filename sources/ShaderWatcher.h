@@ -0,0 +1,83 @@
+#ifndef SHADERWATCHER_H
+#define SHADERWATCHER_H
+
+
+#include <glad/glad.h>
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+
+class GPUProgram;
+
+
+/**
+ * @class ShaderWatcher
+ * @brief Watches the source files of GPUProgram objects and rebuilds them
+ * when they change.
+ *
+ * Programs built with GPUProgram::addShader(fs::path) register themselves.
+ * Once started, a worker thread waits for inotify events on the directories
+ * of every shader file and every file they include. When a file changes, only
+ * the stages that depend on it are recompiled and the program is relinked on
+ * a background GL context that shares objects with the main one. The finished
+ * program is swapped in by applyPending() at the next frame; if compiling or
+ * linking fails, the log is printed and the previous program stays in use.
+ *
+ * Watching is only available on Linux; elsewhere start() returns false.
+ * The watcher is never destroyed, so programs that outlive main(), such as
+ * members of a global application object, can still unregister.
+ */
+class ShaderWatcher {
+
+    struct Pending {
+        GPUProgram* program;
+        GLuint programId;
+        std::vector<GLuint> shaders;
+        std::vector<bool> changed;
+        GLsync fence;
+    };
+
+    std::mutex mutex;
+    std::vector<GPUProgram*> programs;
+    std::vector<Pending> pending;
+    std::unordered_map<int, std::string> watchedDirs;
+    int inotifyFd = -1;
+    int wakeFd = -1;
+    std::atomic<bool> running{false};
+    std::thread worker;
+    std::function<void()> notify;
+
+    void addWatches(const GPUProgram* program);
+    void discard(Pending& entry) const;
+    void run(const std::function<void(bool)>& bindContext);
+    void reload(const std::vector<std::string>& changedFiles);
+
+  public:
+    static ShaderWatcher& instance();
+
+    ShaderWatcher() = default;
+    ShaderWatcher(const ShaderWatcher&) = delete;
+    ShaderWatcher& operator=(const ShaderWatcher&) = delete;
+    ~ShaderWatcher() { stop(); }
+
+    bool start(std::function<void(bool)> bindContext,
+               std::function<void()> onReload);
+    void stop();
+    [[nodiscard]] bool isRunning() const { return running; }
+
+    void watch(GPUProgram* program);
+    void unwatch(GPUProgram* program);
+    bool applyPending();
+
+    // held while a program changes its stages, which the worker reads
+    [[nodiscard]] std::unique_lock<std::mutex> lock() {
+        return std::unique_lock(mutex);
+    }
+};
+
+#endif
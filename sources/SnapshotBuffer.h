@@ -0,0 +1,64 @@
+#ifndef SNAPSHOTBUFFER_H
+#define SNAPSHOTBUFFER_H
+
+
+#include <atomic>
+
+
+/**
+ * @class SnapshotBuffer
+ * @brief Lock-free hand-over of immutable snapshots from one producer thread
+ * to one consumer thread.
+ *
+ * The producer fills back() and calls publish(); the consumer calls acquire()
+ * and reads the returned snapshot until its next acquire(). Producer and
+ * consumer each own one buffer and exchange them through a third, shared slot
+ * with a single atomic exchange, so neither thread ever waits for the other
+ * and a snapshot is never modified while it is being read. If several
+ * snapshots are published between two acquire() calls, only the latest is
+ * seen.
+ *
+ * @tparam T The snapshot type. It must be default constructible and
+ * assignable; assigning into back() reuses the memory of an old snapshot.
+ */
+template <class T>
+class SnapshotBuffer {
+
+    static constexpr unsigned indexMask = 3;
+    static constexpr unsigned freshBit = 4;
+
+    T slots[3];
+    std::atomic<unsigned> shared{1};
+    unsigned writeIndex = 0;
+    unsigned readIndex = 2;
+
+  public:
+    /**
+     * @brief Returns the buffer the producer may fill.
+     */
+    T& back() { return slots[writeIndex]; }
+
+    /**
+     * @brief Makes the content of back() the latest snapshot.
+     */
+    void publish() {
+        writeIndex = shared.exchange(writeIndex | freshBit,
+                                     std::memory_order_acq_rel) &
+                     indexMask;
+    }
+
+    /**
+     * @brief Returns the latest published snapshot.
+     *
+     * The reference stays valid and unchanged until the next call.
+     */
+    const T& acquire() {
+        if (shared.load(std::memory_order_relaxed) & freshBit)
+            readIndex =
+                shared.exchange(readIndex, std::memory_order_acq_rel) &
+                indexMask;
+        return slots[readIndex];
+    }
+};
+
+#endif
@@ -0,0 +1,209 @@
+
+
+#include "TextureAtlas.h"
+#include "PngStreamReader.h"
+#include <algorithm>
+#include <climits>
+#include <cstring>
+
+
+/**
+ * @param size Width and height of every layer in texels.
+ * @param padding Width of the gutter around every image.
+ * @param sampling Minification and magnification filter.
+ */
+TextureAtlas::TextureAtlas(unsigned size, unsigned padding, int sampling)
+    : size(size), padding(padding), sampling(sampling) {}
+
+
+TextureAtlas::~TextureAtlas() {
+    if (textureId > 0)
+        GLState::instance().deleteTextures(1, &textureId);
+}
+
+
+/**
+ * @brief Finds the lowest place on a layer for a rectangle and raises the
+ * skyline over it.
+ *
+ * @return False if the rectangle does not fit on the layer.
+ */
+bool TextureAtlas::place(Layer& layer, unsigned width, unsigned height,
+                         unsigned& x, unsigned& y) const {
+    std::vector<Segment>& skyline = layer.skyline;
+    std::size_t best = skyline.size();
+    unsigned bestY = UINT_MAX;
+    for (std::size_t i = 0; i < skyline.size(); ++i) {
+        if (skyline[i].x + width > size)
+            break; // the segments are ordered by x
+        // the rectangle rests on the highest segment it spans
+        unsigned top = 0, remaining = width;
+        for (std::size_t j = i; remaining > 0; ++j) {
+            top = std::max(top, skyline[j].y);
+            remaining -= std::min(remaining, skyline[j].width);
+        }
+        if (top + height <= size && top < bestY) {
+            best = i;
+            bestY = top;
+        }
+    }
+    if (best == skyline.size())
+        return false;
+
+    x = skyline[best].x;
+    y = bestY;
+    const unsigned end = x + width;
+    std::size_t i = best;
+    while (i < skyline.size() && skyline[i].x < end) {
+        const unsigned segmentEnd = skyline[i].x + skyline[i].width;
+        if (segmentEnd > end) { // partly covered: keep the rest
+            skyline[i].width = segmentEnd - end;
+            skyline[i].x = end;
+            break;
+        }
+        skyline.erase(skyline.begin() + (std::ptrdiff_t)i);
+    }
+    skyline.insert(skyline.begin() + (std::ptrdiff_t)best,
+                   {x, y + height, width});
+    // join neighbours at the same height
+    for (std::size_t j = 0; j + 1 < skyline.size();) {
+        if (skyline[j].y == skyline[j + 1].y) {
+            skyline[j].width += skyline[j + 1].width;
+            skyline.erase(skyline.begin() + (std::ptrdiff_t)j + 1);
+        } else {
+            ++j;
+        }
+    }
+    return true;
+}
+
+
+/**
+ * @brief Packs an image into the atlas. It reaches the GPU at the next
+ * upload() or Bind().
+ *
+ * @param rgba The texels, RGBA8, top row first.
+ * @return Where the image was put, or nothing if it is larger than a layer.
+ */
+std::optional<TextureAtlas::Region>
+TextureAtlas::add(const unsigned char* rgba, unsigned width,
+                  unsigned height) {
+    const unsigned paddedWidth = width + 2 * padding;
+    const unsigned paddedHeight = height + 2 * padding;
+    if (width == 0 || height == 0 || paddedWidth > size ||
+        paddedHeight > size)
+        return std::nullopt;
+
+    unsigned x = 0, y = 0;
+    std::size_t index = 0;
+    while (index < layers.size() &&
+           !place(layers[index], paddedWidth, paddedHeight, x, y))
+        ++index;
+    if (index == layers.size()) { // open a new layer
+        Layer& layer = layers.emplace_back();
+        layer.skyline.push_back({0, 0, size});
+        layer.texels.resize(std::size_t(size) * size * 4);
+        place(layer, paddedWidth, paddedHeight, x, y);
+    }
+    Layer& layer = layers[index];
+    layer.dirty = true;
+
+    const std::size_t rowSize = std::size_t(size) * 4;
+    unsigned char* corner = layer.texels.data() + y * rowSize + x * 4;
+    for (unsigned row = 0; row < height; ++row) {
+        unsigned char* out = corner + (row + padding) * rowSize;
+        const unsigned char* in = rgba + std::size_t(row) * width * 4;
+        memcpy(out + padding * 4, in, std::size_t(width) * 4);
+        for (unsigned i = 0; i < padding; ++i) { // repeat the edge texels
+            memcpy(out + i * 4, in, 4);
+            memcpy(out + (padding + width + i) * 4,
+                   in + std::size_t(width - 1) * 4, 4);
+        }
+    }
+    for (unsigned i = 0; i < padding; ++i) { // and the edge rows
+        memcpy(corner + i * rowSize, corner + padding * rowSize,
+               std::size_t(paddedWidth) * 4);
+        memcpy(corner + (padding + height + i) * rowSize,
+               corner + (padding + height - 1) * rowSize,
+               std::size_t(paddedWidth) * 4);
+    }
+
+    const float scale = 1.0f / float(size);
+    Region region;
+    region.x = x + padding;
+    region.y = y + padding;
+    region.width = width;
+    region.height = height;
+    region.offset = vec2(float(region.x), float(region.y)) * scale;
+    region.scale = vec2(float(width), float(height)) * scale;
+    region.layer = float(index);
+    return region;
+}
+
+
+/**
+ * @brief Decodes a PNG file and packs it into the atlas with its alpha.
+ */
+std::optional<TextureAtlas::Region>
+TextureAtlas::addFile(const std::filesystem::path& pathname) {
+    std::vector<unsigned char> rgba;
+    unsigned width = 0, height = 0;
+    const unsigned error =
+        PngStreamReader::decodeFile(rgba, width, height, pathname);
+    if (error) {
+        printf("%s: %s\n", pathname.string().c_str(),
+               lodepng_error_text(error));
+        return std::nullopt;
+    }
+    std::optional<Region> region = add(rgba.data(), width, height);
+    if (!region)
+        printf("%s: %u x %u does not fit in a %u x %u atlas\n",
+               pathname.string().c_str(), width, height, size, size);
+    return region;
+}
+
+
+/**
+ * @brief Sends the layers changed since the last upload to the GPU. When
+ * layers were added, the array is specified again with all of them.
+ */
+void TextureAtlas::upload() {
+    if (layers.empty())
+        return;
+    if (textureId == 0)
+        glGenTextures(1, &textureId);
+    GLState::instance().bindTexture(GL_TEXTURE_2D_ARRAY, textureId);
+    if (uploadedLayers != layers.size()) {
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, (GLsizei)size,
+                     (GLsizei)size, (GLsizei)layers.size(), 0, GL_RGBA,
+                     GL_UNSIGNED_BYTE, nullptr);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, 0);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, sampling);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, sampling);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S,
+                        GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T,
+                        GL_CLAMP_TO_EDGE);
+        for (Layer& layer : layers)
+            layer.dirty = true;
+        uploadedLayers = layers.size();
+    }
+    for (std::size_t i = 0; i < layers.size(); ++i) {
+        if (!layers[i].dirty)
+            continue;
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, (GLint)i,
+                        (GLsizei)size, (GLsizei)size, 1, GL_RGBA,
+                        GL_UNSIGNED_BYTE, layers[i].texels.data());
+        layers[i].dirty = false;
+    }
+}
+
+
+/**
+ * @brief Binds the array to a texture unit, uploading pending images first.
+ */
+void TextureAtlas::Bind(int textureUnit) {
+    GLState::instance().activeTexture(textureUnit);
+    upload();
+    GLState::instance().bindTexture(GL_TEXTURE_2D_ARRAY, textureId);
+}
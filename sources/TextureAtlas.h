@@ -0,0 +1,85 @@
+#ifndef TEXTUREATLAS_H
+#define TEXTUREATLAS_H
+
+
+#include "framework.h"
+#include <cstddef>
+#include <filesystem>
+#include <optional>
+#include <vector>
+
+
+/**
+ * @class TextureAtlas
+ * @brief Packs many small images into the layers of one GL_TEXTURE_2D_ARRAY,
+ * so objects with different images are drawn with a single bind.
+ *
+ * add() places an RGBA8 image on a layer with a skyline allocator: the top
+ * edge of the packed images is kept as a list of horizontal segments, and an
+ * image goes where its top ends lowest, touching the segments left to right.
+ * An image that fits on no layer opens a new one. Every image is surrounded
+ * by a gutter that repeats its edge texels, so bilinear filtering never
+ * blends in a neighbour. The array has no mip chain, since coarse levels
+ * would blend images across a narrow gutter.
+ *
+ * The returned Region gives the layer and the rectangle in texture
+ * coordinates. A shader samples it with
+ * texture(atlas, vec3(region.offset + uv * region.scale, region.layer)),
+ * the region passed in a uniform or a vertex attribute, so one draw call can
+ * cover objects with any number of images.
+ *
+ * Images are kept on the CPU until upload(), which sends the changed layers
+ * to the GPU, or re-specifies the whole array when layers were added. Like
+ * Texture, the atlas must be used on the thread that owns the GL context.
+ */
+class TextureAtlas {
+
+    struct Segment {
+        unsigned x, y, width; // the packed images end at y over [x, x + width)
+    };
+
+    struct Layer {
+        std::vector<Segment> skyline;
+        std::vector<unsigned char> texels; // RGBA8
+        bool dirty = true;
+    };
+
+    unsigned size;
+    unsigned padding;
+    int sampling;
+    std::vector<Layer> layers;
+    unsigned textureId = 0;
+    std::size_t uploadedLayers = 0;
+
+    bool place(Layer& layer, unsigned width, unsigned height, unsigned& x,
+               unsigned& y) const;
+
+  public:
+    /**
+     * @brief Where an image is in the atlas: texture coordinates
+     * offset + uv * scale on the given layer.
+     */
+    struct Region {
+        vec2 offset, scale;
+        float layer;
+        unsigned x, y, width, height; // in texels, without the gutter
+    };
+
+    explicit TextureAtlas(unsigned size = 1024, unsigned padding = 1,
+                          int sampling = GL_LINEAR);
+    TextureAtlas(const TextureAtlas&) = delete;
+    TextureAtlas& operator=(const TextureAtlas&) = delete;
+    ~TextureAtlas();
+
+    std::optional<Region> add(const unsigned char* rgba, unsigned width,
+                              unsigned height);
+    std::optional<Region> addFile(const std::filesystem::path& pathname);
+
+    void upload();
+    void Bind(int textureUnit);
+
+    [[nodiscard]] unsigned getSize() const { return size; }
+    [[nodiscard]] std::size_t getLayerCount() const { return layers.size(); }
+};
+
+#endif
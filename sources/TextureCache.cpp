@@ -0,0 +1,351 @@
+
+
+#include "TextureCache.h"
+#include "ShaderLoader.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef _WIN32
+#    include <fcntl.h>
+#    include <io.h>
+#    include <share.h>
+#    include <sys/stat.h>
+#    include <thread>
+#else
+#    include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+
+namespace {
+
+constexpr char MAGIC[4] = {'G', 'T', 'X', 'C'};
+constexpr std::uint32_t VERSION = 1;
+constexpr std::size_t DATA_ALIGNMENT = 16;
+
+/**
+ * @brief Fixed part of a cache file. It is followed by levelCount LevelRecord
+ * entries, the source path and, at dataOffset, the texels of every level.
+ */
+struct Header {
+    char magic[4];
+    std::uint32_t version;
+    std::uint32_t flags;
+    std::uint32_t channels;
+    std::uint64_t sourceSize;
+    std::int64_t sourceTime;
+    std::uint32_t levelCount;
+    std::uint32_t pathLength;
+    std::uint64_t dataOffset;
+    std::uint64_t dataSize;
+};
+
+struct LevelRecord {
+    std::uint32_t width;
+    std::uint32_t height;
+    std::uint64_t offset;
+};
+
+
+/**
+ * @brief Size and modification time identifying one version of a source.
+ */
+bool sourceStamp(const fs::path& source, std::uint64_t& size,
+                 std::int64_t& time) {
+    std::error_code ec;
+    size = fs::file_size(source, ec);
+    if (ec)
+        return false;
+    time = fs::last_write_time(source, ec).time_since_epoch().count();
+    return !ec;
+}
+
+
+std::string absoluteName(const fs::path& path) {
+    std::error_code ec;
+    const fs::path absolute = fs::absolute(path, ec);
+    return (ec ? path : absolute).lexically_normal().string();
+}
+
+
+/**
+ * @brief The per-user cache directory of the platform: %LOCALAPPDATA% on
+ * Windows, $XDG_CACHE_HOME or ~/.cache elsewhere. Empty if none is set.
+ */
+fs::path userCacheDirectory() {
+#ifdef _WIN32
+    if (const char* local = getenv("LOCALAPPDATA"); local && *local)
+        return local;
+#else
+    if (const char* xdg = getenv("XDG_CACHE_HOME"); xdg && *xdg == '/')
+        return xdg;
+    if (const char* home = getenv("HOME"); home && *home)
+        return fs::path(home) / ".cache";
+#endif
+    return {};
+}
+
+
+/**
+ * @brief Checks that the level table describes the chain
+ * TextureImage::generateMipmaps() writes: levels packed one after the other
+ * from offset 0, each half the size of the previous one down to 1x1, and
+ * ending exactly at dataSize. Nothing in it can overflow.
+ */
+bool validLevels(const TextureImage& layout, const std::uint64_t dataSize) {
+    std::uint64_t offset = 0;
+    for (std::size_t i = 0; i < layout.levels.size(); ++i) {
+        const TextureImage::Level& level = layout.levels[i];
+        if (i == 0) {
+            if (level.width == 0 || level.height == 0)
+                return false;
+        } else {
+            const TextureImage::Level& previous = layout.levels[i - 1];
+            if ((previous.width == 1 && previous.height == 1) ||
+                level.width != std::max(previous.width / 2, 1u) ||
+                level.height != std::max(previous.height / 2, 1u))
+                return false;
+        }
+        // w * h fits 64 bits; it is compared before multiplying by channels
+        const std::uint64_t texels = std::uint64_t(level.width) * level.height;
+        if (level.offset != offset ||
+            texels > (dataSize - offset) / layout.channels)
+            return false;
+        offset += texels * layout.channels;
+    }
+    return offset == dataSize;
+}
+
+
+/**
+ * @brief Creates a directory and its parents; one it creates is readable
+ * and writable by the owner only.
+ */
+bool createPrivateDirectory(const fs::path& path) {
+    std::error_code ec;
+    if (fs::create_directories(path, ec))
+        fs::permissions(path, fs::perms::owner_all, ec);
+    return fs::is_directory(path, ec);
+}
+
+
+/**
+ * @brief Creates a new, empty file next to path under a name no other file
+ * has, failing rather than opening an existing file or symbolic link.
+ *
+ * @param temporary Receives the name of the file.
+ * @return The file open for binary writing, or nullptr.
+ */
+FILE* createTemporary(const fs::path& path, fs::path& temporary) {
+#ifdef _WIN32
+    for (unsigned attempt = 0; attempt < 16; ++attempt) {
+        temporary = path;
+        temporary += "." +
+                     std::to_string(std::hash<std::thread::id>()(
+                         std::this_thread::get_id())) +
+                     "." + std::to_string(attempt) + ".tmp";
+        int fd = -1;
+        if (_wsopen_s(&fd, temporary.c_str(),
+                      _O_CREAT | _O_EXCL | _O_WRONLY | _O_BINARY, _SH_DENYRW,
+                      _S_IREAD | _S_IWRITE) == 0)
+            return _fdopen(fd, "wb");
+    }
+    return nullptr;
+#else
+    std::string name = path.string() + ".XXXXXX";
+    const int fd = mkstemp(name.data()); // O_CREAT | O_EXCL, mode 0600
+    if (fd < 0)
+        return nullptr;
+    temporary = name;
+    FILE* file = fdopen(fd, "wb");
+    if (!file) {
+        close(fd);
+        unlink(name.c_str());
+    }
+    return file;
+#endif
+}
+
+} // namespace
+
+
+/**
+ * @brief Returns the cache shared by all texture loads.
+ */
+TextureCache& TextureCache::instance() {
+    static TextureCache cache;
+    return cache;
+}
+
+
+/**
+ * @brief Picks the directory from GFX_TEXTURE_CACHE, where an empty value
+ * disables the cache, or the default in the per-user cache directory. With
+ * neither, the cache is disabled rather than shared with other users.
+ */
+TextureCache::TextureCache() {
+    if (const char* path = getenv("GFX_TEXTURE_CACHE")) {
+        directory = path;
+        return;
+    }
+    const fs::path user = userCacheDirectory();
+    if (!user.empty())
+        directory = user / "gfx_texture_cache";
+}
+
+
+/**
+ * @brief Moves the cache to another directory; an empty path disables it.
+ */
+void TextureCache::setDirectory(const fs::path& path) {
+    std::lock_guard lock(mutex);
+    directory = path;
+}
+
+
+bool TextureCache::isEnabled() {
+    std::lock_guard lock(mutex);
+    return !directory.empty();
+}
+
+
+/**
+ * @brief Returns the file holding the entry for a source and flags. Called
+ * with the mutex held.
+ */
+fs::path TextureCache::entryPath(const fs::path& source, unsigned flags) {
+    const std::uint64_t key = ShaderLoader::hash(
+        absoluteName(source), 14695981039346656037ull ^ flags);
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.gtx", (unsigned long long)key);
+    return directory / name;
+}
+
+
+/**
+ * @brief Looks up a cached import of a source file.
+ *
+ * @param source The PNG the texture is loaded from.
+ * @param flags Load flags, a combination of Flags.
+ * @return The mapped entry, or nothing if the cache is disabled, has no
+ * entry, or the entry is stale or damaged.
+ */
+std::optional<TextureCache::Entry> TextureCache::find(const fs::path& source,
+                                                      unsigned flags) {
+    fs::path path;
+    {
+        std::lock_guard lock(mutex);
+        if (directory.empty())
+            return std::nullopt;
+        path = entryPath(source, flags);
+    }
+    std::uint64_t sourceSize;
+    std::int64_t sourceTime;
+    if (!sourceStamp(source, sourceSize, sourceTime))
+        return std::nullopt;
+
+    Entry entry{MappedFile(path), {}, nullptr};
+    const char* bytes = entry.file.data();
+    const std::size_t size = entry.file.size();
+    if (!entry.file.isOpen() || size < sizeof(Header))
+        return std::nullopt;
+    Header header;
+    memcpy(&header, bytes, sizeof(header));
+    const std::string name = absoluteName(source);
+    const std::size_t tableEnd = sizeof(Header) +
+                                 std::size_t(header.levelCount) *
+                                     sizeof(LevelRecord);
+    if (memcmp(header.magic, MAGIC, 4) != 0 || header.version != VERSION ||
+        header.flags != flags || header.sourceSize != sourceSize ||
+        header.sourceTime != sourceTime || header.levelCount == 0 ||
+        (header.channels != 1 && header.channels != 2 &&
+         header.channels != 4) ||
+        header.pathLength != name.size() ||
+        tableEnd + name.size() > header.dataOffset ||
+        header.dataOffset > size ||
+        header.dataSize > size - header.dataOffset ||
+        memcmp(bytes + tableEnd, name.data(), name.size()) != 0)
+        return std::nullopt;
+
+    entry.layout.channels = header.channels;
+    for (std::uint32_t i = 0; i < header.levelCount; ++i) {
+        LevelRecord record;
+        memcpy(&record, bytes + sizeof(Header) + i * sizeof(LevelRecord),
+               sizeof(record));
+        entry.layout.levels.push_back(
+            {record.width, record.height, std::size_t(record.offset)});
+    }
+    if (!validLevels(entry.layout, header.dataSize))
+        return std::nullopt;
+    entry.texels =
+        reinterpret_cast<const unsigned char*>(bytes + header.dataOffset);
+    return entry;
+}
+
+
+/**
+ * @brief Writes an imported image to the cache.
+ *
+ * @return True if the entry was written.
+ */
+bool TextureCache::store(const fs::path& source, unsigned flags,
+                         const TextureImage& image) {
+    fs::path path;
+    {
+        std::lock_guard lock(mutex);
+        if (directory.empty())
+            return false;
+        path = entryPath(source, flags);
+    }
+    Header header{};
+    memcpy(header.magic, MAGIC, 4);
+    header.version = VERSION;
+    header.flags = flags;
+    header.channels = image.channels;
+    if (!sourceStamp(source, header.sourceSize, header.sourceTime))
+        return false;
+    const std::string name = absoluteName(source);
+    header.levelCount = (std::uint32_t)image.levels.size();
+    header.pathLength = (std::uint32_t)name.size();
+    const std::size_t tableEnd =
+        sizeof(Header) + image.levels.size() * sizeof(LevelRecord);
+    header.dataOffset = (tableEnd + name.size() + DATA_ALIGNMENT - 1) /
+                        DATA_ALIGNMENT * DATA_ALIGNMENT;
+    header.dataSize = image.byteSize();
+
+    if (!createPrivateDirectory(path.parent_path()))
+        return false;
+    // a fresh file, renamed over the entry once complete
+    fs::path temporary;
+    FILE* out = createTemporary(path, temporary);
+    if (!out)
+        return false;
+    bool written = fwrite(&header, sizeof(header), 1, out) == 1;
+    for (const TextureImage::Level& level : image.levels) {
+        const LevelRecord record{level.width, level.height, level.offset};
+        written = written && fwrite(&record, sizeof(record), 1, out) == 1;
+    }
+    const char padding[DATA_ALIGNMENT] = {};
+    const std::size_t paddingSize = header.dataOffset - tableEnd - name.size();
+    written = written &&
+              fwrite(name.data(), 1, name.size(), out) == name.size() &&
+              fwrite(padding, 1, paddingSize, out) == paddingSize &&
+              fwrite(image.texels.data(), 1, header.dataSize, out) ==
+                  header.dataSize;
+    written = fclose(out) == 0 && written;
+    std::error_code ec;
+    if (!written) {
+        fs::remove(temporary, ec);
+        return false;
+    }
+    fs::rename(temporary, path, ec);
+    if (ec) {
+        fs::remove(temporary, ec);
+        return false;
+    }
+    return true;
+}
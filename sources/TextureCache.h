@@ -0,0 +1,66 @@
+#ifndef TEXTURECACHE_H
+#define TEXTURECACHE_H
+
+
+#include "MappedFile.h"
+#include "TextureImage.h"
+#include <filesystem>
+#include <mutex>
+#include <optional>
+
+
+/**
+ * @class TextureCache
+ * @brief Keeps imported textures on disk so later launches skip PNG decoding.
+ *
+ * After a PNG is decoded and imported (see TextureImage), store() writes its
+ * texels and whole mip chain to a small binary container in the cache
+ * directory. find() maps such a file with MappedFile and returns its layout
+ * and a pointer to the texels, which can be uploaded as they are. An entry is
+ * keyed by the absolute source path and the load flags, and is used only
+ * while the size and modification time of the source match the ones stored
+ * in it, so a changed PNG is decoded again.
+ *
+ * The directory defaults to gfx_texture_cache in the per-user cache
+ * directory ($XDG_CACHE_HOME, ~/.cache or %LOCALAPPDATA%), created readable
+ * by its owner only, and can be changed, or the cache disabled, by the
+ * GFX_TEXTURE_CACHE environment variable or setDirectory(). Files are written
+ * to a new temporary file and renamed, so concurrent loaders never read a
+ * partial entry, and find() checks every level against the file size.
+ */
+class TextureCache {
+
+    std::mutex mutex;
+    std::filesystem::path directory;
+
+    std::filesystem::path entryPath(const std::filesystem::path& source,
+                                    unsigned flags);
+
+  public:
+    /**
+     * @brief A mapped cache entry; texels stays valid while the entry lives.
+     */
+    struct Entry {
+        MappedFile file;
+        TextureImage layout; // channels and levels, without texels
+        const unsigned char* texels = nullptr;
+    };
+
+    enum Flags : unsigned { ALPHA_FROM_COLOUR = 1 }; // Texture(path, true)
+
+    static TextureCache& instance();
+
+    TextureCache();
+    TextureCache(const TextureCache&) = delete;
+    TextureCache& operator=(const TextureCache&) = delete;
+
+    void setDirectory(const std::filesystem::path& path);
+    [[nodiscard]] bool isEnabled();
+
+    std::optional<Entry> find(const std::filesystem::path& source,
+                              unsigned flags);
+    bool store(const std::filesystem::path& source, unsigned flags,
+               const TextureImage& image);
+};
+
+#endif
@@ -0,0 +1,602 @@
+
+
+#include "TextureImage.h"
+#include "GLState.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#    include <emmintrin.h>
+#    define TEXTUREIMAGE_SSE2
+#endif
+
+
+namespace {
+
+/**
+ * @brief Threads kept for parallelFor(), started on first use, so a mip chain
+ * does not start and join a set of threads for every level.
+ *
+ * The calling thread takes chunks as well. One parallelFor() uses the pool
+ * at a time; another one, e.g. from a second thread or nested in a body, gets
+ * false from run() and runs serially.
+ */
+class WorkerPool {
+
+    std::mutex mutex;
+    std::condition_variable wake, done;
+    std::vector<std::thread> threads;
+    const std::function<void(std::size_t)>* task = nullptr;
+    std::size_t chunkCount = 0, nextChunk = 0, running = 0;
+    bool stopping = false;
+    std::atomic<bool> busy{false};
+
+    // takes chunks until none is left; called with the mutex locked
+    void work(std::unique_lock<std::mutex>& lock) {
+        const std::function<void(std::size_t)>* body = task;
+        while (nextChunk < chunkCount) {
+            const std::size_t chunk = nextChunk++;
+            ++running;
+            lock.unlock();
+            (*body)(chunk);
+            lock.lock();
+            --running;
+        }
+        if (running == 0)
+            done.notify_all();
+    }
+
+    void loop() {
+        std::unique_lock lock(mutex);
+        while (true) {
+            wake.wait(lock,
+                      [this] { return stopping || nextChunk < chunkCount; });
+            if (stopping)
+                return;
+            work(lock);
+        }
+    }
+
+  public:
+    static WorkerPool& instance() {
+        static WorkerPool pool;
+        return pool;
+    }
+
+    ~WorkerPool() {
+        {
+            std::lock_guard lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread& thread : threads)
+            thread.join();
+    }
+
+    // runs body(0) ... body(chunks - 1) and returns when all are done
+    bool run(std::size_t chunks, const std::function<void(std::size_t)>& body) {
+        if (busy.exchange(true))
+            return false;
+        std::unique_lock lock(mutex);
+        if (threads.empty()) {
+            const unsigned count =
+                std::max(std::thread::hardware_concurrency(), 2u) - 1;
+            for (unsigned i = 0; i < count; ++i)
+                threads.emplace_back(&WorkerPool::loop, this);
+        }
+        task = &body;
+        chunkCount = chunks;
+        nextChunk = 0;
+        wake.notify_all();
+        work(lock);
+        done.wait(lock, [this] { return running == 0; });
+        task = nullptr;
+        chunkCount = nextChunk = 0;
+        lock.unlock();
+        busy = false;
+        return true;
+    }
+};
+
+
+/**
+ * @brief Runs body(begin, end) over [0, count) split into contiguous ranges,
+ * at most one per thread, on the worker pool. Small ranges run on the
+ * calling thread.
+ */
+template <typename Body>
+void parallelFor(std::size_t count, unsigned threadCount, std::size_t grain,
+                 const Body& body) {
+    const std::size_t chunks =
+        std::min<std::size_t>(threadCount, (count + grain - 1) / grain);
+    if (chunks <= 1) {
+        body(std::size_t(0), count);
+        return;
+    }
+    const std::size_t step = (count + chunks - 1) / chunks;
+    const std::function<void(std::size_t)> range = [&](std::size_t chunk) {
+        const std::size_t begin = chunk * step;
+        body(begin, std::min(begin + step, count));
+    };
+    if (!WorkerPool::instance().run((count + step - 1) / step, range))
+        body(std::size_t(0), count);
+}
+
+
+/**
+ * @brief Sets alpha to (r + g + b) / 6, as the Texture file constructor always
+ * did, four texels per step.
+ */
+void deriveAlpha(unsigned char* rgba, std::size_t count) {
+    std::size_t i = 0;
+#ifdef TEXTUREIMAGE_SSE2
+    const __m128i byteMask = _mm_set1_epi32(0xff);
+    const __m128i colourMask = _mm_set1_epi32(0x00ffffff);
+    const __m128i sixth = _mm_set1_epi16(10923); // (s * 10923) >> 16 == s / 6
+    for (; i + 4 <= count; i += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(rgba + 4 * i));
+        __m128i sum = _mm_add_epi32(
+            _mm_add_epi32(_mm_and_si128(v, byteMask),
+                          _mm_and_si128(_mm_srli_epi32(v, 8), byteMask)),
+            _mm_and_si128(_mm_srli_epi32(v, 16), byteMask));
+        __m128i alpha = _mm_slli_epi32(_mm_mulhi_epu16(sum, sixth), 24);
+        v = _mm_or_si128(_mm_and_si128(v, colourMask), alpha);
+        _mm_storeu_si128((__m128i*)(rgba + 4 * i), v);
+    }
+#endif
+    for (; i < count; ++i) {
+        unsigned char* p = rgba + 4 * i;
+        p[3] = (unsigned char)((p[0] + p[1] + p[2]) / 6);
+    }
+}
+
+
+/**
+ * @brief Finds the narrowest format for RGBA8 texels: 1 if every texel is an
+ * opaque grey, 2 if every texel is a grey, 4 otherwise.
+ */
+unsigned analyze(const unsigned char* rgba, std::size_t count) {
+    uint32_t colour = 0, alpha = 0; // bits set by non-grey / non-opaque texels
+    std::size_t i = 0;
+#ifdef TEXTUREIMAGE_SSE2
+    const __m128i greyMask = _mm_set1_epi32(0x0000ffff);
+    const __m128i alphaMask = _mm_set1_epi32(int(0xff000000u));
+    __m128i colours = _mm_setzero_si128(), alphas = _mm_setzero_si128();
+    for (; i + 4 <= count; i += 4) {
+        const __m128i v = _mm_loadu_si128((const __m128i*)(rgba + 4 * i));
+        // r ^ g and g ^ b land in the low two bytes: zero for a grey
+        colours = _mm_or_si128(
+            colours,
+            _mm_and_si128(_mm_xor_si128(v, _mm_srli_epi32(v, 8)), greyMask));
+        alphas = _mm_or_si128(alphas, _mm_andnot_si128(v, alphaMask));
+    }
+    alignas(16) uint32_t lanes[8];
+    _mm_store_si128((__m128i*)lanes, colours);
+    _mm_store_si128((__m128i*)(lanes + 4), alphas);
+    colour = lanes[0] | lanes[1] | lanes[2] | lanes[3];
+    alpha = lanes[4] | lanes[5] | lanes[6] | lanes[7];
+#endif
+    for (; i < count; ++i) {
+        const unsigned char* p = rgba + 4 * i;
+        colour |= (p[0] ^ p[1]) | (p[1] ^ p[2]);
+        alpha |= p[3] ^ 0xff;
+    }
+    if (colour)
+        return 4;
+    return alpha ? 2 : 1;
+}
+
+
+/**
+ * @brief Copies the red, or red and alpha, channels of RGBA8 texels.
+ */
+void narrow(const unsigned char* rgba, std::size_t count, unsigned channels,
+            unsigned char* out) {
+    std::size_t i = 0;
+#ifdef TEXTUREIMAGE_SSE2
+    const __m128i byteMask = _mm_set1_epi32(0xff);
+    for (; i + 8 <= count; i += 8) {
+        __m128i a = _mm_loadu_si128((const __m128i*)(rgba + 4 * i));
+        __m128i b = _mm_loadu_si128((const __m128i*)(rgba + 4 * i + 16));
+        if (channels == 1) {
+            a = _mm_and_si128(a, byteMask);
+            b = _mm_and_si128(b, byteMask);
+            const __m128i words = _mm_packs_epi32(a, b);
+            _mm_storel_epi64((__m128i*)(out + i),
+                             _mm_packus_epi16(words, words));
+        } else {
+            // 16-bit r | a << 8, sign extended so packs keeps the bits
+            a = _mm_or_si128(_mm_and_si128(a, byteMask),
+                             _mm_slli_epi32(_mm_srli_epi32(a, 24), 8));
+            b = _mm_or_si128(_mm_and_si128(b, byteMask),
+                             _mm_slli_epi32(_mm_srli_epi32(b, 24), 8));
+            a = _mm_srai_epi32(_mm_slli_epi32(a, 16), 16);
+            b = _mm_srai_epi32(_mm_slli_epi32(b, 16), 16);
+            _mm_storeu_si128((__m128i*)(out + 2 * i), _mm_packs_epi32(a, b));
+        }
+    }
+#endif
+    for (; i < count; ++i) {
+        out[channels * i] = rgba[4 * i];
+        if (channels == 2)
+            out[2 * i + 1] = rgba[4 * i + 3];
+    }
+}
+
+
+/**
+ * @brief Converts floats to bytes, clamping to [0, 1] and rounding.
+ */
+void floatsToBytes(const float* in, std::size_t count, unsigned char* out) {
+    std::size_t i = 0;
+#ifdef TEXTUREIMAGE_SSE2
+    const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f);
+    const __m128 scale = _mm_set1_ps(255.0f), half = _mm_set1_ps(0.5f);
+    auto convert = [&](const float* p) {
+        const __m128 v = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(p), zero), one);
+        return _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(v, scale), half));
+    };
+    for (; i + 16 <= count; i += 16) {
+        const __m128i low =
+            _mm_packs_epi32(convert(in + i), convert(in + i + 4));
+        const __m128i high =
+            _mm_packs_epi32(convert(in + i + 8), convert(in + i + 12));
+        _mm_storeu_si128((__m128i*)(out + i), _mm_packus_epi16(low, high));
+    }
+#endif
+    for (; i < count; ++i) {
+        const float v = std::min(std::max(in[i], 0.0f), 1.0f);
+        out[i] = (unsigned char)(v * 255.0f + 0.5f);
+    }
+}
+
+
+/**
+ * @brief Builds an image from RGBA8 texels, narrowing it to the fewest
+ * channels that hold it exactly.
+ */
+TextureImage narrowed(const unsigned char* rgba, unsigned width,
+                      unsigned height) {
+    const std::size_t count = std::size_t(width) * height;
+    TextureImage image;
+    image.channels = analyze(rgba, count);
+    image.levels.push_back({width, height, 0});
+    image.texels.resize(count * image.channels);
+    if (image.channels == 4)
+        memcpy(image.texels.data(), rgba, count * 4);
+    else
+        narrow(rgba, count, image.channels, image.texels.data());
+    return image;
+}
+
+
+/**
+ * @brief Compiles and links a compute shader, printing the log on failure.
+ *
+ * @return The program, or 0 on failure.
+ */
+GLuint buildCompute(const std::string& source) {
+    const GLuint shader = glCreateShader(GL_COMPUTE_SHADER);
+    const char* text = source.c_str();
+    glShaderSource(shader, 1, &text, nullptr);
+    glCompileShader(shader);
+    GLint status = 0, logLength = 0;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+    if (!status) {
+        glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &logLength);
+        std::string log(std::size_t(std::max(logLength, 1)), '\0');
+        glGetShaderInfoLog(shader, logLength, nullptr, log.data());
+        printf("Procedural texture shader error! \n Log: \n%s\n",
+               log.c_str());
+        glDeleteShader(shader);
+        return 0;
+    }
+    const GLuint program = glCreateProgram();
+    glAttachShader(program, shader);
+    glLinkProgram(program);
+    glDeleteShader(shader); // stays alive while attached
+    glGetProgramiv(program, GL_LINK_STATUS, &status);
+    if (!status) {
+        printf("Failed to link procedural texture shader\n");
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+
+/**
+ * @brief Box filters rows [begin, end) of the next level from the level
+ * before, C channels per texel. An odd last row or column is repeated.
+ */
+template <unsigned C>
+void downsample(const unsigned char* source, unsigned sourceWidth,
+                unsigned sourceHeight, unsigned char* target, unsigned width,
+                std::size_t begin, std::size_t end) {
+    const std::size_t sourceRow = std::size_t(sourceWidth) * C;
+    for (std::size_t y = begin; y < end; ++y) {
+        const unsigned char* row0 = source + 2 * y * sourceRow;
+        const unsigned char* row1 =
+            2 * y + 1 < sourceHeight ? row0 + sourceRow : row0;
+        unsigned char* out = target + y * width * C;
+        for (unsigned x = 0; x < width; ++x) {
+            const unsigned x0 = 2 * x * C;
+            const unsigned x1 = 2 * x + 1 < sourceWidth ? x0 + C : x0;
+            for (unsigned k = 0; k < C; ++k)
+                out[x * C + k] =
+                    (unsigned char)((row0[x0 + k] + row0[x1 + k] +
+                                     row1[x0 + k] + row1[x1 + k] + 2) >> 2);
+        }
+    }
+}
+
+} // namespace
+
+
+/**
+ * @brief Imports RGBA8 texels, e.g. as decoded by lodepng_decode32.
+ *
+ * @param deriveAlpha Replace alpha with (r + g + b) / 6, the transparency
+ * used by Texture(path, true).
+ */
+TextureImage TextureImage::fromRgba8(const unsigned char* rgba,
+                                     unsigned width, unsigned height,
+                                     bool deriveAlpha) {
+    if (!deriveAlpha)
+        return narrowed(rgba, width, height);
+    const std::size_t count = std::size_t(width) * height;
+    std::vector<unsigned char> copy(rgba, rgba + 4 * count);
+    ::deriveAlpha(copy.data(), count);
+    return narrowed(copy.data(), width, height);
+}
+
+
+/**
+ * @brief Imports RGBA8 texels by taking over their buffer. Alpha derivation
+ * and narrowing work in place, so the image is never copied, and a buffer
+ * reserved with room for the mip chain keeps it for generateMipmaps().
+ */
+TextureImage TextureImage::fromRgba8(std::vector<unsigned char>&& rgba,
+                                     unsigned width, unsigned height,
+                                     bool deriveAlpha) {
+    const std::size_t count = std::size_t(width) * height;
+    if (deriveAlpha)
+        ::deriveAlpha(rgba.data(), count);
+    TextureImage image;
+    image.channels = analyze(rgba.data(), count);
+    image.levels.push_back({width, height, 0});
+    if (image.channels != 4) // texel i only moves to a lower address
+        narrow(rgba.data(), count, image.channels, rgba.data());
+    rgba.resize(count * image.channels);
+    image.texels = std::move(rgba);
+    return image;
+}
+
+
+/**
+ * @brief Generates an image on several threads and narrows it.
+ *
+ * Each thread fills a contiguous band of rows, handing them to the generator
+ * a tile of about 16 KiB at a time, top to bottom, so the writes run along
+ * rows in memory and stay in cache.
+ *
+ * @param rows Called as rows(y, count, rgba) to write count whole rows of
+ * RGBA8 texels, from row y on, to rgba. Runs on several threads at once.
+ * @param threadCount Number of threads, 0 to use every core.
+ */
+TextureImage TextureImage::generate(unsigned width, unsigned height,
+                                    const RowGenerator& rows,
+                                    unsigned threadCount) {
+    if (threadCount == 0)
+        threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+    const std::size_t rowSize = std::size_t(width) * 4;
+    std::vector<unsigned char> rgba(rowSize * height);
+    const std::size_t tile = std::max<std::size_t>(1, 16384 / (rowSize + 1));
+    parallelFor(height, threadCount, tile,
+                [&](std::size_t begin, std::size_t end) {
+        for (std::size_t y = begin; y < end; y += tile) {
+            const std::size_t count = std::min(tile, end - y);
+            rows(unsigned(y), unsigned(count), rgba.data() + y * rowSize);
+        }
+    });
+    return fromRgba8(std::move(rgba), width, height, false);
+}
+
+
+/**
+ * @brief Fills the texture bound to GL_TEXTURE_2D on the GPU with a compute
+ * shader and builds its mip chain there, so the texels never exist on the
+ * CPU. Needs OpenGL 4.3.
+ *
+ * @param texel GLSL source defining vec4 texel(ivec2 position, ivec2 size),
+ * which returns the colour of a texel in [0, 1].
+ * @param sampling GL_LINEAR or GL_NEAREST, as for upload().
+ * @return Bytes of texture memory, or 0 if the shader could not run.
+ */
+std::size_t TextureImage::generateOnGpu(unsigned width, unsigned height,
+                                        const char* texel, int sampling) {
+    if (!GLAD_GL_VERSION_4_3) {
+        printf("Procedural textures on the GPU need OpenGL 4.3\n");
+        return 0;
+    }
+    const GLuint program = buildCompute(
+        std::string("#version 430\n"
+                    "layout(local_size_x = 8, local_size_y = 8) in;\n"
+                    "layout(rgba8, binding = 0) uniform writeonly image2D "
+                    "target;\n") +
+        texel +
+        "\nvoid main() {\n"
+        "    ivec2 position = ivec2(gl_GlobalInvocationID.xy);\n"
+        "    ivec2 size = imageSize(target);\n"
+        "    if (all(lessThan(position, size)))\n"
+        "        imageStore(target, position, texel(position, size));\n"
+        "}\n");
+    if (!program)
+        return 0;
+
+    TextureImage layout; // only for the level sizes
+    layout.levels.push_back({width, height, 0});
+    for (unsigned w = width, h = height; w > 1 || h > 1;) {
+        w = std::max(w / 2, 1u);
+        h = std::max(h / 2, 1u);
+        layout.levels.push_back({w, h, layout.byteSize()});
+    }
+    GLint texture = 0, previous = 0;
+    glGetIntegerv(GL_TEXTURE_BINDING_2D, &texture);
+    glGetIntegerv(GL_CURRENT_PROGRAM, &previous);
+    glTexStorage2D(GL_TEXTURE_2D, (GLsizei)layout.levels.size(), GL_RGBA8,
+                   (GLsizei)width, (GLsizei)height);
+    glBindImageTexture(0, (GLuint)texture, 0, GL_FALSE, 0, GL_WRITE_ONLY,
+                       GL_RGBA8);
+    GLState::instance().useProgram(program);
+    glDispatchCompute((width + 7) / 8, (height + 7) / 8, 1);
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT |
+                    GL_TEXTURE_UPDATE_BARRIER_BIT);
+    GLState::instance().useProgram((GLuint)previous);
+    GLState::instance().deleteProgram(program);
+    glGenerateMipmap(GL_TEXTURE_2D);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+                    sampling == GL_NEAREST ? GL_NEAREST_MIPMAP_NEAREST
+                                           : GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, sampling);
+    return layout.byteSize();
+}
+
+
+/**
+ * @brief Imports opaque RGB8 texels, e.g. as decoded by lodepng_decode24.
+ */
+TextureImage TextureImage::fromRgb8(const unsigned char* rgb, unsigned width,
+                                    unsigned height) {
+    const std::size_t count = std::size_t(width) * height;
+    std::vector<unsigned char> rgba(4 * count);
+    for (std::size_t i = 0; i < count; ++i) {
+        rgba[4 * i] = rgb[3 * i];
+        rgba[4 * i + 1] = rgb[3 * i + 1];
+        rgba[4 * i + 2] = rgb[3 * i + 2];
+        rgba[4 * i + 3] = 0xff;
+    }
+    return narrowed(rgba.data(), width, height);
+}
+
+
+/**
+ * @brief Imports opaque float RGB texels in [0, 1], e.g. a vec3 image,
+ * converting them to 8 bits per channel.
+ */
+TextureImage TextureImage::fromFloatRgb(const float* rgb, unsigned width,
+                                        unsigned height) {
+    const std::size_t count = std::size_t(width) * height;
+    std::vector<unsigned char> bytes(3 * count);
+    floatsToBytes(rgb, 3 * count, bytes.data());
+    return fromRgb8(bytes.data(), width, height);
+}
+
+
+/**
+ * @brief Appends every mip level down to 1x1 with a 2x2 box filter. Odd
+ * edges repeat their last texel. The rows of each level are split among
+ * threads.
+ *
+ * @param threadCount Number of threads, 0 to use every core.
+ */
+void TextureImage::generateMipmaps(unsigned threadCount) {
+    if (threadCount == 0)
+        threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+    levels.resize(1);
+    unsigned width = levels[0].width, height = levels[0].height;
+    std::size_t size = texels.size();
+    while (width > 1 || height > 1) {
+        const unsigned w = std::max(width / 2, 1u);
+        const unsigned h = std::max(height / 2, 1u);
+        levels.push_back({w, h, size});
+        size += std::size_t(w) * h * channels;
+        width = w;
+        height = h;
+    }
+    texels.resize(size);
+
+    const auto filter = channels == 1   ? downsample<1>
+                        : channels == 2 ? downsample<2>
+                                        : downsample<4>;
+    for (std::size_t level = 1; level < levels.size(); ++level) {
+        const Level& from = levels[level - 1];
+        const Level& to = levels[level];
+        const unsigned char* source = texels.data() + from.offset;
+        unsigned char* target = texels.data() + to.offset;
+        const std::size_t sourceRow = std::size_t(from.width) * channels;
+        const std::size_t grain = std::max<std::size_t>(1, 16384 / sourceRow);
+        parallelFor(to.height, threadCount, grain,
+                    [&](std::size_t begin, std::size_t end) {
+            filter(source, from.width, from.height, target, to.width, begin,
+                   end);
+        });
+    }
+}
+
+
+/**
+ * @brief Size of all levels in bytes, computed from the level table, so it
+ * also holds for a layout whose texels are stored elsewhere.
+ */
+std::size_t TextureImage::byteSize() const {
+    if (levels.empty())
+        return 0;
+    const Level& last = levels.back();
+    return last.offset + std::size_t(last.width) * last.height * channels;
+}
+
+
+GLenum TextureImage::internalFormat() const {
+    return channels == 1 ? GL_R8 : channels == 2 ? GL_RG8 : GL_RGBA8;
+}
+
+
+GLenum TextureImage::format() const {
+    return channels == 1 ? GL_RED : channels == 2 ? GL_RG : GL_RGBA;
+}
+
+
+/**
+ * @brief Specifies every level of the texture bound to GL_TEXTURE_2D and sets
+ * its filters and swizzle.
+ *
+ * @param sampling GL_LINEAR or GL_NEAREST; with a mip chain minification also
+ * filters between levels.
+ * @param source Texel data, or nullptr when the texels are in the bound
+ * GL_PIXEL_UNPACK_BUFFER at the same offsets.
+ */
+void TextureImage::upload(int sampling, const unsigned char* source) const {
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1); // rows are not padded
+    for (std::size_t level = 0; level < levels.size(); ++level)
+        glTexImage2D(GL_TEXTURE_2D, (GLint)level, (GLint)internalFormat(),
+                     (GLsizei)levels[level].width,
+                     (GLsizei)levels[level].height, 0, format(),
+                     GL_UNSIGNED_BYTE,
+                     (const void*)(uintptr_t(source) + levels[level].offset));
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL,
+                    (GLint)levels.size() - 1);
+
+    const GLint grey[4][4] = {{GL_RED, GL_RED, GL_RED, GL_ONE},
+                              {GL_RED, GL_RED, GL_RED, GL_GREEN},
+                              {GL_RED, GL_GREEN, GL_BLUE, GL_ALPHA},
+                              {GL_RED, GL_GREEN, GL_BLUE, GL_ALPHA}};
+    glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA,
+                     grey[channels - 1]);
+
+    GLint minFilter = sampling;
+    if (levels.size() > 1)
+        minFilter = sampling == GL_NEAREST ? GL_NEAREST_MIPMAP_NEAREST
+                                           : GL_LINEAR_MIPMAP_LINEAR;
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, minFilter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, sampling);
+}
@@ -0,0 +1,66 @@
+#ifndef TEXTUREIMAGE_H
+#define TEXTUREIMAGE_H
+
+
+#include <glad/glad.h>
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+
+/**
+ * @class TextureImage
+ * @brief CPU side of a texture: 8-bit texels in the narrowest format that
+ * holds them, with an optional mip chain.
+ *
+ * Images are imported from RGBA8, RGB8 or float RGB data, or generated
+ * procedurally on several threads. Channel conversion, alpha derivation and
+ * format analysis use SSE2 where available. The result is stored as R8 when
+ * every texel is an opaque grey, RG8 when it is a grey with alpha and RGBA8
+ * otherwise; R8 and RG8 textures are swizzled on upload, so shaders still
+ * sample the original colours. Every mip level is kept in one contiguous
+ * buffer, so the whole chain can be copied into a pixel buffer object or a
+ * file at once.
+ */
+class TextureImage {
+
+  public:
+    struct Level {
+        unsigned width, height;
+        std::size_t offset; // in bytes, from the start of texels
+    };
+
+    using RowGenerator =
+        std::function<void(unsigned y, unsigned count, unsigned char* rgba)>;
+
+    unsigned channels = 4; // 1: R8, 2: RG8, 4: RGBA8
+    std::vector<Level> levels;
+    std::vector<unsigned char> texels;
+
+    static TextureImage fromRgba8(const unsigned char* rgba, unsigned width,
+                                  unsigned height, bool deriveAlpha);
+    static TextureImage fromRgba8(std::vector<unsigned char>&& rgba,
+                                  unsigned width, unsigned height,
+                                  bool deriveAlpha);
+    static TextureImage fromRgb8(const unsigned char* rgb, unsigned width,
+                                 unsigned height);
+    static TextureImage fromFloatRgb(const float* rgb, unsigned width,
+                                     unsigned height);
+    static TextureImage generate(unsigned width, unsigned height,
+                                 const RowGenerator& rows,
+                                 unsigned threadCount = 0);
+    static std::size_t generateOnGpu(unsigned width, unsigned height,
+                                     const char* texel, int sampling);
+
+    void generateMipmaps(unsigned threadCount = 0);
+
+    [[nodiscard]] unsigned getWidth() const { return levels[0].width; }
+    [[nodiscard]] unsigned getHeight() const { return levels[0].height; }
+    [[nodiscard]] std::size_t byteSize() const;
+    [[nodiscard]] GLenum internalFormat() const;
+    [[nodiscard]] GLenum format() const;
+
+    void upload(int sampling, const unsigned char* source) const;
+};
+
+#endif
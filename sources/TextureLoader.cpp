@@ -0,0 +1,264 @@
+
+
+#include "TextureLoader.h"
+#include "framework.h"
+#include <cstring>
+
+
+namespace {
+
+/**
+ * @brief Maps a cached import of a PNG file, or reads and decodes it the same
+ * way as the Texture file constructor and caches the result.
+ *
+ * @return Error code of lodepng, 0 on success.
+ */
+unsigned decodeFile(const std::string& path, bool transparent,
+                    TextureImage& image,
+                    std::optional<TextureCache::Entry>& cached) {
+    const unsigned flags =
+        transparent ? unsigned(TextureCache::ALPHA_FROM_COLOUR) : 0u;
+    cached = TextureCache::instance().find(path, flags);
+    if (cached)
+        return 0;
+    std::vector<unsigned char> data;
+    unsigned width = 0, height = 0;
+    const unsigned error = PngStreamReader::decodeFile(data, width, height,
+                                                       path, false, true);
+    if (!error) {
+        image = TextureImage::fromRgba8(std::move(data), width, height,
+                                        transparent);
+        image.generateMipmaps(1); // the workers already run in parallel
+        TextureCache::instance().store(path, flags, image);
+    }
+    return error;
+}
+
+} // namespace
+
+
+/**
+ * @brief Returns the loader shared by the whole application.
+ */
+TextureLoader& TextureLoader::instance() {
+    static TextureLoader loader;
+    return loader;
+}
+
+
+/**
+ * @brief Stops the workers. GL objects are released by stop(), which needs the
+ * context, so the destructor only joins the threads.
+ */
+TextureLoader::~TextureLoader() {
+    {
+        std::lock_guard lock(mutex);
+        running = false;
+        jobs.clear();
+    }
+    jobReady.notify_all();
+    for (std::thread& worker : workers)
+        worker.join();
+}
+
+
+/**
+ * @brief Starts loading a texture in the background.
+ *
+ * @param pathname PNG file to load.
+ * @param transparent Whether to load RGBA with alpha derived from the colour.
+ * @param sampling Minification and magnification filter.
+ * @return A texture that shows a grey placeholder until its image is uploaded.
+ */
+std::shared_ptr<Texture>
+TextureLoader::load(const std::filesystem::path& pathname, bool transparent,
+                    int sampling) {
+    std::vector<vec3> placeholder(1, vec3(0.5f, 0.5f, 0.5f));
+    auto texture = std::make_shared<Texture>(1, 1, placeholder);
+
+    std::lock_guard lock(mutex);
+    if (!running) { // workers are started on the first load
+        running = true;
+        const unsigned count =
+            std::max(std::thread::hardware_concurrency(), 2u) - 1;
+        for (unsigned i = 0; i < count; ++i)
+            workers.emplace_back(&TextureLoader::run, this);
+    }
+    jobs.push_back({texture, pathname.string(), transparent, sampling});
+    jobReady.notify_one();
+    return texture;
+}
+
+
+/**
+ * @brief Sets a callback run on a worker thread whenever a decoded image is
+ * waiting for applyPending(), e.g. to wake up the main loop.
+ */
+void TextureLoader::setNotify(std::function<void()> onDecoded) {
+    std::lock_guard lock(mutex);
+    notify = std::move(onDecoded);
+}
+
+
+/**
+ * @brief Limits the bytes uploaded by one applyPending() call. One image is
+ * always uploaded, however large.
+ */
+void TextureLoader::setUploadBudget(std::size_t bytesPerFrame) {
+    std::lock_guard lock(mutex);
+    uploadBudget = bytesPerFrame;
+}
+
+
+/**
+ * @brief Returns true if no texture is queued, decoding or waiting for upload.
+ */
+bool TextureLoader::isIdle() {
+    std::lock_guard lock(mutex);
+    return jobs.empty() && decoding == 0 && decoded.empty();
+}
+
+
+/**
+ * @brief Worker thread: decodes queued files until the loader stops.
+ */
+void TextureLoader::run() {
+    std::unique_lock lock(mutex);
+    while (true) {
+        jobReady.wait(lock, [this] { return !running || !jobs.empty(); });
+        if (!running)
+            return;
+        Job job = std::move(jobs.front());
+        jobs.pop_front();
+        if (job.texture.expired()) { // released, but finish() may wait
+            jobDone.notify_all();
+            continue;
+        }
+        ++decoding;
+        lock.unlock();
+
+        Image image{job.texture, job.path, job.sampling, {}, std::nullopt};
+        const unsigned error = decodeFile(job.path, job.transparent,
+                                          image.image, image.cached);
+        if (error)
+            printf("%s: %s\n", job.path.c_str(), lodepng_error_text(error));
+
+        lock.lock();
+        --decoding;
+        if (!error)
+            decoded.push_back(std::move(image));
+        jobDone.notify_all();
+        if (!error && notify) {
+            const std::function<void()> callback = notify;
+            lock.unlock();
+            callback();
+            lock.lock();
+        }
+    }
+}
+
+
+/**
+ * @brief Copies an image into the next pixel buffer and specifies the texture
+ * storage from it. The buffer is orphaned first, so the copy never waits for
+ * the GPU to finish reading the previous upload.
+ */
+void TextureLoader::upload(Image& image) {
+    const std::shared_ptr<Texture> texture = image.texture.lock();
+    if (!texture)
+        return;
+    const TextureImage& layout = image.layout();
+    const unsigned char* texels =
+        image.cached ? image.cached->texels : image.image.texels.data();
+    const GLsizeiptr size = (GLsizeiptr)layout.byteSize();
+    if (pixelBuffers[0] == 0)
+        glGenBuffers(2, pixelBuffers);
+    GLState::instance().bindBuffer(GL_PIXEL_UNPACK_BUFFER,
+                                   pixelBuffers[nextBuffer]);
+    nextBuffer = (nextBuffer + 1) % 2;
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+    void* mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size,
+                                    GL_MAP_WRITE_BIT |
+                                        GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (mapped) {
+        memcpy(mapped, texels, (size_t)size);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    } else {
+        GLState::instance().bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+
+    GLState::instance().bindTexture(GL_TEXTURE_2D, texture->textureId);
+    layout.upload(image.sampling, mapped ? nullptr : texels);
+    texture->byteSize = layout.byteSize();
+    GLState::instance().bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    printf("%s, w: %u, h: %u\n", image.path.c_str(), layout.getWidth(),
+           layout.getHeight());
+}
+
+
+/**
+ * @brief Uploads decoded images, up to the upload budget.
+ *
+ * @return True if at least one texture changed, i.e. the screen is stale.
+ */
+bool TextureLoader::applyPending() {
+    std::vector<Image> ready;
+    bool more;
+    {
+        std::lock_guard lock(mutex);
+        std::size_t bytes = 0;
+        while (!decoded.empty()) {
+            const std::size_t size = decoded.front().layout().byteSize();
+            if (!ready.empty() && bytes + size > uploadBudget)
+                break;
+            bytes += size;
+            ready.push_back(std::move(decoded.front()));
+            decoded.pop_front();
+        }
+        more = !decoded.empty();
+    }
+    for (Image& image : ready)
+        upload(image);
+    if (more && notify) // come back for the rest at the next frame
+        notify();
+    return !ready.empty();
+}
+
+
+/**
+ * @brief Waits until every queued texture is decoded and uploads all of them,
+ * e.g. before rendering offline, where placeholders must never show.
+ */
+void TextureLoader::finish() {
+    {
+        std::unique_lock lock(mutex);
+        jobDone.wait(lock, [this] { return jobs.empty() && decoding == 0; });
+    }
+    std::vector<Image> ready;
+    {
+        std::lock_guard lock(mutex);
+        ready.assign(std::make_move_iterator(decoded.begin()),
+                     std::make_move_iterator(decoded.end()));
+        decoded.clear();
+    }
+    for (Image& image : ready)
+        upload(image);
+}
+
+
+/**
+ * @brief Drops queued work and deletes the pixel buffers. The workers keep
+ * running, so textures can still be loaded afterwards.
+ */
+void TextureLoader::stop() {
+    {
+        std::unique_lock lock(mutex);
+        jobs.clear();
+        jobDone.wait(lock, [this] { return decoding == 0; });
+        decoded.clear();
+    }
+    if (pixelBuffers[0] != 0) {
+        GLState::instance().deleteBuffers(2, pixelBuffers);
+        pixelBuffers[0] = pixelBuffers[1] = 0;
+    }
+}
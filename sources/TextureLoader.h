@@ -0,0 +1,97 @@
+#ifndef TEXTURELOADER_H
+#define TEXTURELOADER_H
+
+
+#include "TextureCache.h"
+#include "TextureImage.h"
+#include <glad/glad.h>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+class Texture;
+
+
+/**
+ * @class TextureLoader
+ * @brief Loads textures from PNG files without blocking the GL thread.
+ *
+ * load() returns at once with a texture holding a one-texel placeholder, so
+ * it can be bound and drawn with immediately. The file is read and decoded on
+ * a pool of worker threads, imported with its mip chain (see TextureImage),
+ * or mapped from the TextureCache if it was imported before, and uploaded
+ * through a pixel buffer object by applyPending(), which the framework calls
+ * at every frame boundary. At most uploadBudget bytes are uploaded per call,
+ * so loading many textures at once does not stall a single frame.
+ *
+ * load(), applyPending(), finish() and stop() must be called on the thread
+ * that owns the GL context. A texture released before its image arrives is
+ * simply skipped.
+ */
+class TextureLoader {
+
+    struct Job {
+        std::weak_ptr<Texture> texture;
+        std::string path;
+        bool transparent;
+        int sampling;
+    };
+
+    struct Image {
+        std::weak_ptr<Texture> texture;
+        std::string path;
+        int sampling;
+        TextureImage image;
+        std::optional<TextureCache::Entry> cached; // replaces image if set
+
+        [[nodiscard]] const TextureImage& layout() const {
+            return cached ? cached->layout : image;
+        }
+    };
+
+    std::mutex mutex;
+    std::condition_variable jobReady, jobDone;
+    std::deque<Job> jobs;
+    std::deque<Image> decoded;
+    std::vector<std::thread> workers;
+    unsigned decoding = 0;
+    bool running = false;
+    std::function<void()> notify;
+    std::size_t uploadBudget = std::size_t(32) << 20;
+    GLuint pixelBuffers[2] = {0, 0};
+    unsigned nextBuffer = 0;
+
+    void run();
+    void upload(Image& image);
+
+  public:
+    static TextureLoader& instance();
+
+    TextureLoader() = default;
+    TextureLoader(const TextureLoader&) = delete;
+    TextureLoader& operator=(const TextureLoader&) = delete;
+    ~TextureLoader();
+
+    std::shared_ptr<Texture> load(const std::filesystem::path& pathname,
+                                  bool transparent = false,
+                                  int sampling = GL_LINEAR);
+
+    void setNotify(std::function<void()> onDecoded);
+    void setUploadBudget(std::size_t bytesPerFrame);
+    [[nodiscard]] bool isIdle();
+
+    bool applyPending();
+    void finish();
+    void stop();
+};
+
+#endif
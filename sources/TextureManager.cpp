@@ -0,0 +1,119 @@
+
+
+#include "TextureManager.h"
+#include "framework.h"
+#include <cstdlib>
+#include <tuple>
+
+
+bool TextureManager::Key::operator<(const Key& other) const {
+    return std::tie(path, transparent, sampling) <
+           std::tie(other.path, other.transparent, other.sampling);
+}
+
+
+/**
+ * @brief Returns the manager shared by the whole application.
+ */
+TextureManager& TextureManager::instance() {
+    static TextureManager manager;
+    return manager;
+}
+
+
+/**
+ * @brief Takes the budget from GFX_TEXTURE_BUDGET, in MiB, if it is set.
+ */
+TextureManager::TextureManager() {
+    if (const char* value = getenv("GFX_TEXTURE_BUDGET")) {
+        char* end = nullptr;
+        const unsigned long long mebibytes = strtoull(value, &end, 10);
+        if (end != value)
+            budget = std::size_t(mebibytes) << 20;
+    }
+}
+
+
+/**
+ * @brief Returns the texture of a PNG file, loading it only if no texture of
+ * the same file and flags is resident.
+ *
+ * @param pathname PNG file to load.
+ * @param transparent Whether to load RGBA with alpha derived from the colour.
+ * @param sampling Minification and magnification filter.
+ * @param background Load with TextureLoader, showing a placeholder until the
+ * image is uploaded, instead of decoding before returning.
+ * @return A handle the texture lives at least as long as.
+ */
+std::shared_ptr<Texture>
+TextureManager::acquire(const fs::path& pathname, bool transparent,
+                        int sampling, bool background) {
+    std::error_code ec;
+    const fs::path absolute = fs::absolute(pathname, ec);
+    Key key{(ec ? pathname : absolute).lexically_normal().string(),
+            transparent, sampling};
+    if (const auto found = index.find(key); found != index.end()) {
+        ++hits;
+        entries.splice(entries.begin(), entries, found->second);
+        return found->second->texture;
+    }
+
+    ++misses;
+    std::shared_ptr<Texture> texture =
+        background
+            ? TextureLoader::instance().load(pathname, transparent, sampling)
+            : std::make_shared<Texture>(pathname, transparent, sampling);
+    entries.push_front({key, texture});
+    index.emplace(std::move(key), entries.begin());
+    trim(); // the new texture is held by the caller, so it stays
+    return texture;
+}
+
+
+/**
+ * @brief Changes the budget and evicts textures beyond it at once.
+ */
+void TextureManager::setBudget(std::size_t bytes) {
+    budget = bytes;
+    trim();
+}
+
+
+/**
+ * @brief Sums the GPU memory of every texture the manager knows of, whether
+ * or not the application still holds it.
+ */
+std::size_t TextureManager::residentBytes() const {
+    std::size_t bytes = 0;
+    for (const Entry& entry : entries)
+        bytes += entry.texture->getByteSize();
+    return bytes;
+}
+
+
+/**
+ * @brief Deletes the least recently used textures that only the manager
+ * holds, until the resident textures fit the budget. Textures loaded in the
+ * background count with their final size once they are uploaded.
+ */
+void TextureManager::trim() {
+    std::size_t bytes = residentBytes();
+    for (auto it = entries.end(); bytes > budget && it != entries.begin();) {
+        --it;
+        if (it->texture.use_count() > 1)
+            continue; // still in use, deleting it would free nothing
+        bytes -= it->texture->getByteSize();
+        index.erase(it->key);
+        it = entries.erase(it);
+    }
+}
+
+
+/**
+ * @brief Forgets every texture. Textures the application still holds stay
+ * valid; the others are deleted, so call it while the GL context is current.
+ */
+void TextureManager::clear() {
+    index.clear();
+    entries.clear();
+}
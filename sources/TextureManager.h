@@ -0,0 +1,78 @@
+#ifndef TEXTUREMANAGER_H
+#define TEXTUREMANAGER_H
+
+
+#include <glad/glad.h>
+#include <cstddef>
+#include <filesystem>
+#include <list>
+#include <map>
+#include <memory>
+#include <string>
+
+
+class Texture;
+
+
+/**
+ * @class TextureManager
+ * @brief Shares textures loaded from the same file and keeps recently used
+ * ones resident within a memory budget.
+ *
+ * acquire() returns a reference-counted handle. Loads with the same absolute
+ * path, transparency and sampling get the same GL texture, so only the first
+ * one decodes the file and uploads it. The manager keeps a handle to every
+ * texture in least-recently-used order. When the textures it knows of take
+ * more than the budget, it drops the least recently used ones that nobody
+ * else holds. A texture that is still in use is never deleted, so the budget
+ * bounds the memory kept for later loads, not the memory the application
+ * itself holds.
+ *
+ * The budget is 256 MiB by default. It can be changed by the
+ * GFX_TEXTURE_BUDGET environment variable, in MiB, or by setBudget(). Like
+ * TextureLoader, the manager must only be used on the thread that owns the GL
+ * context; the framework calls clear() before the context is destroyed.
+ */
+class TextureManager {
+
+    struct Key {
+        std::string path; // absolute and normalized
+        bool transparent;
+        int sampling;
+
+        bool operator<(const Key& other) const;
+    };
+
+    struct Entry {
+        Key key;
+        std::shared_ptr<Texture> texture;
+    };
+
+    std::list<Entry> entries; // most recently used first
+    std::map<Key, std::list<Entry>::iterator> index;
+    std::size_t budget = std::size_t(256) << 20;
+    std::size_t hits = 0, misses = 0;
+
+  public:
+    static TextureManager& instance();
+
+    TextureManager();
+    TextureManager(const TextureManager&) = delete;
+    TextureManager& operator=(const TextureManager&) = delete;
+
+    std::shared_ptr<Texture> acquire(const std::filesystem::path& pathname,
+                                     bool transparent = false,
+                                     int sampling = GL_LINEAR,
+                                     bool background = false);
+
+    void setBudget(std::size_t bytes);
+    void trim();
+    void clear();
+
+    [[nodiscard]] std::size_t getBudget() const { return budget; }
+    [[nodiscard]] std::size_t residentBytes() const;
+    [[nodiscard]] std::size_t getHits() const { return hits; }
+    [[nodiscard]] std::size_t getMisses() const { return misses; }
+};
+
+#endif
@@ -0,0 +1,97 @@
+
+
+#include "TiledRenderer.h"
+#include "PngStreamWriter.h"
+#include <algorithm>
+
+
+/**
+ * @brief Computes the transform that maps the normalized device coordinates
+ * of a tile region onto [-1, 1].
+ *
+ * @param width Width of the whole image in pixels.
+ * @param height Height of the whole image in pixels.
+ * @param x0 Left edge of the tile in pixels.
+ * @param y0 Bottom edge of the tile in pixels (OpenGL orientation).
+ * @param tileWidth Width of the tile in pixels.
+ * @param tileHeight Height of the tile in pixels.
+ * @return The transform to apply after the regular vertex transformation.
+ */
+mat4 TiledRenderer::tileTransform(const unsigned width, const unsigned height,
+                                  const unsigned x0, const unsigned y0,
+                                  const unsigned tileWidth,
+                                  const unsigned tileHeight) {
+    const float sx = static_cast<float>(width) / tileWidth;
+    const float sy = static_cast<float>(height) / tileHeight;
+    const float tx = sx - 2.0f * x0 / tileWidth - 1.0f;
+    const float ty = sy - 2.0f * y0 / tileHeight - 1.0f;
+    return translate(vec3(tx, ty, 0)) * scale(vec3(sx, sy, 1));
+}
+
+
+/**
+ * @brief Renders the image tile by tile and writes it to a PNG file.
+ *
+ * Must be called on the thread that owns the GL context. The framebuffer
+ * binding and the viewport are restored afterwards.
+ *
+ * @param file The output PNG file.
+ * @param width Width of the image in pixels.
+ * @param height Height of the image in pixels.
+ * @param draw Renders the scene with the given view transform.
+ * @return True if the file was written.
+ */
+bool TiledRenderer::render(const fs::path& file, const unsigned width,
+                           const unsigned height,
+                           const std::function<void(const mat4&)>& draw) const {
+    GLint previousFramebuffer = 0, previousViewport[4];
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFramebuffer);
+    glGetIntegerv(GL_VIEWPORT, previousViewport);
+
+    GLuint framebuffer, colorBuffer;
+    glGenRenderbuffers(1, &colorBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, tileSize, tileSize);
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                              GL_RENDERBUFFER, colorBuffer);
+
+    PngStreamWriter writer;
+    bool ok = glCheckFramebufferStatus(GL_FRAMEBUFFER) ==
+                  GL_FRAMEBUFFER_COMPLETE &&
+              writer.open(file, width, height);
+
+    const size_t rowSize = static_cast<size_t>(width) * 4;
+    std::vector<unsigned char> band(ok ? rowSize * tileSize : 0);
+    std::vector<unsigned char> tile(ok ? tileSize * tileSize * 4 : 0);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+
+    // tile rows from the top, the order in which PNG stores them
+    for (unsigned top = 0; ok && top < height; top += tileSize) {
+        const unsigned tileHeight = std::min(tileSize, height - top);
+        const unsigned y0 = height - top - tileHeight;
+        for (unsigned x0 = 0; x0 < width; x0 += tileSize) {
+            const unsigned tileWidth = std::min(tileSize, width - x0);
+            glViewport(0, 0, tileWidth, tileHeight);
+            draw(tileTransform(width, height, x0, y0, tileWidth, tileHeight));
+            glReadPixels(0, 0, tileWidth, tileHeight, GL_RGBA,
+                         GL_UNSIGNED_BYTE, tile.data());
+            // flip the tile vertically into its place in the band
+            for (unsigned y = 0; y < tileHeight; ++y)
+                std::copy_n(tile.data() + (tileHeight - 1 - y) * tileWidth * 4,
+                            tileWidth * 4, band.data() + y * rowSize + x0 * 4);
+        }
+        ok = writer.writeRows(band.data(), tileHeight);
+    }
+    ok = writer.close() && ok;
+
+    glDeleteFramebuffers(1, &framebuffer);
+    glDeleteRenderbuffers(1, &colorBuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+    glViewport(previousViewport[0], previousViewport[1], previousViewport[2],
+               previousViewport[3]);
+    printf("Poster %s (%ux%u) %s\n", file.string().c_str(), width, height,
+           ok ? "written" : "failed");
+    return ok;
+}
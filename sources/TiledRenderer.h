@@ -0,0 +1,37 @@
+#ifndef TILEDRENDERER_H
+#define TILEDRENDERER_H
+
+
+#include "framework.h"
+#include <functional>
+
+
+/**
+ * @class TiledRenderer
+ * @brief Renders images far larger than any framebuffer, tile by tile,
+ * streaming the result straight into a PNG file.
+ *
+ * The image is split into square tiles that are rendered one after the other
+ * into a small offscreen framebuffer. For every tile the draw callback receives
+ * a view transform that maps the tile's part of normalized device coordinates
+ * onto the whole framebuffer; a vertex shader that applies it renders the
+ * scene exactly as it would appear in one huge window. A full row of tiles is
+ * read back and handed to a PngStreamWriter before the next row is rendered,
+ * so peak memory is one tile row, independently of the image height.
+ */
+class TiledRenderer {
+
+    unsigned tileSize;
+
+  public:
+    explicit TiledRenderer(unsigned tileSize = 1024) : tileSize(tileSize) {}
+
+    static mat4 tileTransform(unsigned width, unsigned height, unsigned x0,
+                              unsigned y0, unsigned tileWidth,
+                              unsigned tileHeight);
+
+    bool render(const fs::path& file, unsigned width, unsigned height,
+                const std::function<void(const mat4& view)>& draw) const;
+};
+
+#endif
@@ -0,0 +1,254 @@
+#ifndef VERTEXFORMAT_H
+#define VERTEXFORMAT_H
+
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <type_traits>
+
+
+/**
+ * @brief A 16-bit floating point number, stored as its bits, for
+ * GL_HALF_FLOAT attributes.
+ */
+struct Half {
+    std::uint16_t bits = 0;
+
+    Half() = default;
+
+    // rounds to the nearest half, ties to even
+    explicit Half(float value) {
+        std::uint32_t f;
+        memcpy(&f, &value, sizeof f);
+        const std::uint32_t sign = (f >> 16) & 0x8000;
+        const std::uint32_t magnitude = f & 0x7fffffff;
+        if (magnitude >= 0x7f800000) { // infinity or NaN
+            bits = std::uint16_t(sign | 0x7c00 |
+                                 (magnitude > 0x7f800000 ? 0x200 : 0));
+        } else if (magnitude >= 0x477ff000) { // rounds beyond 65504
+            bits = std::uint16_t(sign | 0x7c00);
+        } else if (magnitude < 0x38800000) { // subnormal or zero
+            const std::uint32_t shift = 126 - (magnitude >> 23);
+            if (shift > 24) {
+                bits = std::uint16_t(sign);
+                return;
+            }
+            const std::uint32_t mantissa = (magnitude & 0x7fffff) | 0x800000;
+            std::uint32_t half = mantissa >> shift;
+            const std::uint32_t rest = mantissa & ((1u << shift) - 1);
+            const std::uint32_t middle = 1u << (shift - 1);
+            if (rest > middle || (rest == middle && (half & 1)))
+                ++half;
+            bits = std::uint16_t(sign | half);
+        } else {
+            std::uint32_t half = (magnitude - 0x38000000) >> 13;
+            const std::uint32_t rest = magnitude & 0x1fff;
+            if (rest > 0x1000 || (rest == 0x1000 && (half & 1)))
+                ++half; // a carry into the exponent is still right
+            bits = std::uint16_t(sign | half);
+        }
+    }
+};
+
+
+/**
+ * @brief Where an attribute is in a vertex and how GL reads it.
+ */
+struct VertexAttribute {
+    GLuint location;
+    GLint size; // components, 1 to 4
+    GLenum type; // of a component
+    GLboolean normalized; // integers read as floats in [0, 1] or [-1, 1]
+    bool integer; // integers read as ints, by ivec or uvec inputs
+    std::size_t offset; // bytes from the start of the vertex
+};
+
+
+/**
+ * @brief GL type of one component of an attribute, by its C++ type.
+ */
+template <class C>
+constexpr GLenum componentType() {
+    if constexpr (std::is_same_v<C, float>)
+        return GL_FLOAT;
+    else if constexpr (std::is_same_v<C, Half>)
+        return GL_HALF_FLOAT;
+    else if constexpr (std::is_same_v<C, std::int8_t>)
+        return GL_BYTE;
+    else if constexpr (std::is_same_v<C, std::uint8_t>)
+        return GL_UNSIGNED_BYTE;
+    else if constexpr (std::is_same_v<C, std::int16_t>)
+        return GL_SHORT;
+    else if constexpr (std::is_same_v<C, std::uint16_t>)
+        return GL_UNSIGNED_SHORT;
+    else if constexpr (std::is_same_v<C, std::int32_t>)
+        return GL_INT;
+    else if constexpr (std::is_same_v<C, std::uint32_t>)
+        return GL_UNSIGNED_INT;
+    else
+        static_assert(sizeof(C) == 0, "no GL vertex attribute type for this");
+}
+
+
+/**
+ * @brief Component type and count of an attribute, by its C++ type: a
+ * scalar, an array of up to four scalars, or a glm float vector.
+ */
+template <class A>
+struct AttributeComponents {
+    static constexpr GLenum type = componentType<A>();
+    static constexpr GLint size = 1;
+};
+
+template <class C, std::size_t N>
+struct AttributeComponents<C[N]> {
+    static_assert(N >= 1 && N <= 4, "an attribute has 1 to 4 components");
+    static constexpr GLenum type = componentType<C>();
+    static constexpr GLint size = GLint(N);
+};
+
+template <>
+struct AttributeComponents<glm::vec2> {
+    static constexpr GLenum type = GL_FLOAT;
+    static constexpr GLint size = 2;
+};
+
+template <>
+struct AttributeComponents<glm::vec3> {
+    static constexpr GLenum type = GL_FLOAT;
+    static constexpr GLint size = 3;
+};
+
+template <>
+struct AttributeComponents<glm::vec4> {
+    static constexpr GLenum type = GL_FLOAT;
+    static constexpr GLint size = 4;
+};
+
+
+/**
+ * @brief Describes an attribute of type A at offset in the vertex, e.g.
+ * vertexAttribute<decltype(V::colour)>(1, offsetof(V, colour), true).
+ *
+ * @param normalized Integer components are read as normalized floats.
+ * @param integer Integer components are read as integers.
+ */
+template <class A>
+constexpr VertexAttribute vertexAttribute(GLuint location, std::size_t offset,
+                                          bool normalized = false,
+                                          bool integer = false) {
+    using Components = AttributeComponents<A>;
+    return {location,
+            Components::size,
+            Components::type,
+            GLboolean(normalized ? GL_TRUE : GL_FALSE),
+            integer,
+            offset};
+}
+
+
+/**
+ * @brief The vertex attributes of a vertex type, as a constexpr array named
+ * attributes, and optionally divisor: 0 for per-vertex data, n to advance
+ * once every n instances.
+ *
+ * The primary template keeps the single float attribute at location 0 that
+ * Geometry has always used, with up to four components. A vertex with more
+ * or other attributes specializes it:
+ *
+ *     struct ColouredVertex {
+ *         vec2 position;
+ *         std::uint8_t colour[4];
+ *     };
+ *     template <> struct VertexFormat<ColouredVertex> {
+ *         static constexpr VertexAttribute attributes[] = {
+ *             vertexAttribute<vec2>(0, offsetof(ColouredVertex, position)),
+ *             vertexAttribute<std::uint8_t[4]>(
+ *                 1, offsetof(ColouredVertex, colour), true)};
+ *     };
+ */
+template <class T>
+struct VertexFormat {
+    static constexpr VertexAttribute attributes[] = {
+        {0, std::min(GLint(sizeof(T) / sizeof(float)), 4), GL_FLOAT,
+         GL_FALSE, false, 0}};
+};
+
+
+template <class T>
+constexpr GLuint vertexDivisor() {
+    if constexpr (requires { VertexFormat<T>::divisor; })
+        return VertexFormat<T>::divisor;
+    else
+        return 0;
+}
+
+
+constexpr std::size_t componentBytes(GLenum type) {
+    switch (type) {
+    case GL_BYTE:
+    case GL_UNSIGNED_BYTE:
+        return 1;
+    case GL_SHORT:
+    case GL_UNSIGNED_SHORT:
+    case GL_HALF_FLOAT:
+        return 2;
+    default:
+        return 4;
+    }
+}
+
+
+/**
+ * @brief Whether the attributes of T lie inside the vertex, use each
+ * location once, and read floats neither normalized nor as integers.
+ */
+template <class T>
+constexpr bool validVertexFormat() {
+    const auto& attributes = VertexFormat<T>::attributes;
+    for (std::size_t i = 0; i < std::size(attributes); ++i) {
+        const VertexAttribute& a = attributes[i];
+        const bool floating = a.type == GL_FLOAT || a.type == GL_HALF_FLOAT;
+        if (a.size < 1 || a.size > 4 || a.location >= 16 ||
+            a.offset + a.size * componentBytes(a.type) > sizeof(T) ||
+            (floating && (a.normalized || a.integer)) ||
+            (a.normalized && a.integer))
+            return false;
+        for (std::size_t j = 0; j < i; ++j)
+            if (attributes[j].location == a.location)
+                return false;
+    }
+    return true;
+}
+
+
+/**
+ * @brief Sets up the attributes of T in the bound vertex array, reading
+ * vertices of sizeof(T) bytes from the bound GL_ARRAY_BUFFER.
+ */
+template <class T>
+void setVertexFormat() {
+    static_assert(validVertexFormat<T>(),
+                  "VertexFormat: attribute outside the vertex, location used "
+                  "twice, or float attribute normalized or read as integer");
+    constexpr GLuint divisor = vertexDivisor<T>();
+    for (const VertexAttribute& a : VertexFormat<T>::attributes) {
+        const void* offset = reinterpret_cast<const void*>(a.offset);
+        glEnableVertexAttribArray(a.location);
+        if (a.integer)
+            glVertexAttribIPointer(a.location, a.size, a.type, sizeof(T),
+                                   offset);
+        else
+            glVertexAttribPointer(a.location, a.size, a.type, a.normalized,
+                                  sizeof(T), offset);
+        if (divisor > 0)
+            glVertexAttribDivisor(a.location, divisor);
+    }
+}
+
+#endif
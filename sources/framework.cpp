@@ -4,15 +4,61 @@
 #include "framework.h"
 #define GLFW_INCLUDE_NONE
 #include <GLFW/glfw3.h>
+#include "FrameCapture.h"
+#include "TiledRenderer.h"
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#ifdef GFX_HEADLESS_EGL
+#    include "HeadlessContext.h"
+#endif
 
 // Keretrendszer �llapota
 static int minorNumber = 3, majorNumber = 3;
 static int windowWidth = 600, windowHeight = 600;
 static const char* windowCaption = "Grafika";
 static GLFWwindow* window;
-static bool screenRefresh = true;
+static std::atomic<bool> screenRefresh = true;
+static bool shaderHotReload = false;
+static bool eventDriven = false, animating = false;
+static int swapInterval = 1;
+static double frameInterval = 0, nextFrameTime = 0;
+static bool coalesceMotion = false, motionPending = false;
+static double motionX = 0, motionY = 0;
+static bool renderThread = false;
+static std::thread renderer;
+static std::atomic<bool> rendering = false, swapIntervalChanged = false;
+static std::atomic<unsigned> frameRequests = 0;
+static std::string captureDirectory;
+// read on the main thread, as GLFW requires, and captured by the renderer
+struct FramebufferSize {
+    int width, height;
+};
+static std::atomic<FramebufferSize> framebufferSize{FramebufferSize{600, 600}};
+static std::unique_ptr<FrameCapture> frameCapture;
+static mat4 viewMatrix = mat4(1.0f);
+struct PosterJob {
+    std::string file;
+    unsigned width, height;
+};
+static std::mutex posterMutex;
+static std::optional<PosterJob> posterJob;
 static glApp* pApp = nullptr;
 
+// Delivers the coalesced cursor motion of this frame, if any. With latch the
+// position is sampled again right before rendering.
+static void dispatchMotion(bool latch) {
+    if (!motionPending)
+        return;
+    motionPending = false;
+    if (latch)
+        glfwGetCursorPos(window, &motionX, &motionY);
+    pApp->onMouseMotion((int)motionX, (int)motionY);
+}
+
 // Esem�nykezel�k
 static void error_callback(int error, const char* description) {
     fprintf(stderr, "Error: %s\n", description);
@@ -22,6 +68,11 @@ static void window_refresh_callback(GLFWwindow* window) {
     screenRefresh = true;
 }
 
+static void framebuffer_size_callback(GLFWwindow* window, int width,
+                                      int height) {
+    framebufferSize = FramebufferSize{width, height};
+}
+
 static void key_callback(GLFWwindow* window, int key, int scancode, int action,
                          int mods) {
     if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS) {
@@ -37,11 +88,13 @@ static void key_callback(GLFWwindow* window, int key, int scancode, int action,
 }
 
 void character_callback(GLFWwindow* window, unsigned int codepoint) {
+    dispatchMotion(false); // keep the order of queued input
     pApp->onKeyboard(codepoint);
 }
 
 void mouse_button_callback(GLFWwindow* window, int button, int action,
                            int mods) {
+    dispatchMotion(false); // keep the order of queued input
     double pX, pY;
     glfwGetCursorPos(window, &pX, &pY);
     if (action == GLFW_PRESS)
@@ -56,7 +109,13 @@ void mouse_button_callback(GLFWwindow* window, int button, int action,
 
 static void cursor_position_callback(GLFWwindow* window, double xpos,
                                      double ypos) {
-    pApp->onMouseMotion((int)xpos, (int)ypos);
+    if (!coalesceMotion) {
+        pApp->onMouseMotion((int)xpos, (int)ypos);
+        return;
+    }
+    motionX = xpos; // only the last position of a frame is delivered
+    motionY = ypos;
+    motionPending = true;
 }
 
 // Applik�ci� konstruktora
@@ -84,10 +143,190 @@ glApp::glApp(const char* _windowCaption) {
 // Rajzold �jra az alkalmaz�si ablakot
 void glApp::refreshScreen() { screenRefresh = true; }
 
+// Shader hot reload: rebuild file based programs when their sources change
+void glApp::watchShaders(bool enable) { shaderHotReload = enable; }
+
+// Event driven mode: block in glfwWaitEvents while nothing has to be drawn
+void glApp::setEventDriven(bool enable) { eventDriven = enable; }
+
+// Keep the loop running (onTimeElapsed every frame) even in event driven mode
+void glApp::setAnimating(bool enable) {
+    animating = enable;
+    if (window)
+        glfwPostEmptyEvent(); // leave a blocking wait right away
+}
+
+// Deliver at most one onMouseMotion per frame, sampled just before onDisplay
+void glApp::setCoalesceMotion(bool enable) { coalesceMotion = enable; }
+
+void glApp::setSwapInterval(int interval) {
+    swapInterval = interval;
+    if (rendering)
+        swapIntervalChanged = true; // applied by the render thread
+    else if (window)
+        glfwSwapInterval(swapInterval);
+}
+
+// Record every rendered frame as a PNG sequence (GFX_CAPTURE=<directory>)
+void glApp::captureFrames(const char* directory) {
+    captureDirectory = directory ? directory : "";
+}
+
+// Queues the frame just drawn for capture, before the buffers are swapped
+static void captureFrame() {
+    if (!frameCapture)
+        return;
+    const FramebufferSize size = framebufferSize;
+    frameCapture->capture(size.width, size.height);
+}
+
+// View transform to apply in vertex shaders, identity except for poster tiles
+const mat4& glApp::viewTransform() { return viewMatrix; }
+
+// Render the scene as a tiled poster at the next frame (GFX_POSTER=<file>)
+void glApp::renderPoster(const char* file, unsigned width, unsigned height) {
+    {
+        std::lock_guard lock(posterMutex);
+        posterJob = PosterJob{file, width, height};
+    }
+    screenRefresh = true;
+    if (window)
+        glfwPostEmptyEvent();
+}
+
+// Renders a requested poster, on the thread that owns the GL context
+static void renderPendingPoster() {
+    std::optional<PosterJob> job;
+    {
+        std::lock_guard lock(posterMutex);
+        job.swap(posterJob);
+    }
+    if (!job)
+        return;
+    TiledRenderer().render(job->file, job->width, job->height,
+                           [](const mat4& view) {
+                               viewMatrix = view;
+                               pApp->onDisplay();
+                           });
+    viewMatrix = mat4(1.0f);
+}
+
+// Run onDisplay on a dedicated thread that owns the GL context
+void glApp::setRenderThread(bool enable) { renderThread = enable; }
+
+// Render thread: draws a frame whenever the main thread requests one
+static void renderLoop() {
+    glfwMakeContextCurrent(window);
+    unsigned served = 0;
+    while (true) {
+        frameRequests.wait(served); // sleep until the next request
+        if (!rendering)
+            break;
+        served = frameRequests.load();
+        if (swapIntervalChanged.exchange(false))
+            glfwSwapInterval(swapInterval);
+        if (shaderHotReload)
+            ShaderWatcher::instance().applyPending();
+        TextureLoader::instance().applyPending();
+        renderPendingPoster();
+        pApp->onDisplay();
+        captureFrame();
+        glfwSwapBuffers(window);
+    }
+    glfwMakeContextCurrent(NULL);
+}
+
+// Hands a frame to the render thread without waiting for it
+static void requestFrame() {
+    frameRequests.fetch_add(1);
+    frameRequests.notify_one();
+}
+
+void glApp::setFrameRateLimit(double fps) {
+    frameInterval = fps > 0 ? 1.0 / fps : 0;
+}
+
+// Waits for events without spinning: sleeps while idle, and until the next
+// frame slot when a capped frame is due
+static void waitForEvents() {
+    const bool frameDue = screenRefresh || animating || motionPending;
+    const double now = glfwGetTime();
+    if (frameDue && frameInterval > 0 && nextFrameTime > now)
+        glfwWaitEventsTimeout(nextFrameTime - now);
+    else if (frameDue || !eventDriven)
+        glfwPollEvents();
+    else
+        glfwWaitEvents();
+}
+
 // Lek�rdez�ses klaviat�ra kezel�s
-bool pollKey(int key) { return (glfwGetKey(window, key) == GLFW_PRESS); }
+bool pollKey(int key) {
+    return window && glfwGetKey(window, key) == GLFW_PRESS;
+}
+
+#ifdef GFX_HEADLESS_EGL
+// Headless backend: renders a fixed number of frames into an offscreen
+// framebuffer, without a window or input, then optionally saves the last one
+static int runHeadless(long frames, const char* output) {
+    HeadlessContext context;
+    if (!context.create(majorNumber, minorNumber, windowWidth, windowHeight))
+        return EXIT_FAILURE;
+    framebufferSize = FramebufferSize{windowWidth, windowHeight};
+
+    pApp->onInitialization();
+    if (!captureDirectory.empty()) // offline: never drop frames
+        frameCapture = std::make_unique<FrameCapture>(captureDirectory, true);
+    using clock = std::chrono::steady_clock;
+    const auto start = clock::now();
+    float startTime = 0;
+    for (long frame = 0; frame < frames; ++frame) {
+        const float endTime =
+            std::chrono::duration<float>(clock::now() - start).count();
+        pApp->onTimeElapsed(startTime, endTime);
+        startTime = endTime;
+        TextureLoader::instance().finish(); // offline: no placeholders
+        context.bindFramebuffer();
+        pApp->onDisplay();
+        captureFrame();
+        glFlush();
+    }
+    renderPendingPoster();
+    glFinish();
+    const double seconds =
+        std::chrono::duration<double>(clock::now() - start).count();
+    printf("Headless: %ld frames in %.3f s (%.3f ms/frame)\n", frames, seconds,
+           frames > 0 ? 1000.0 * seconds / frames : 0.0);
+    printf("Headless: GL state calls %zu issued, %zu skipped\n",
+           GLState::instance().getIssued(), GLState::instance().getSkipped());
+    if (frameCapture) {
+        frameCapture->finish();
+        frameCapture.reset();
+    }
+    TextureLoader::instance().stop();
+    TextureManager::instance().clear();
+    if (output && !context.savePng(output))
+        return EXIT_FAILURE;
+    return EXIT_SUCCESS;
+}
+#endif
 
 int main(void) {
+    if (const char* directory = getenv("GFX_CAPTURE"))
+        captureDirectory = directory;
+    if (const char* poster = getenv("GFX_POSTER")) { // GFX_POSTER_SIZE=WxH
+        unsigned width = 8192, height = 8192;
+        if (const char* size = getenv("GFX_POSTER_SIZE"))
+            sscanf(size, "%ux%u", &width, &height);
+        glApp::renderPoster(poster, width, height);
+    }
+
+#ifdef GFX_HEADLESS_EGL
+    // GFX_HEADLESS=<frames> runs without a display, see runHeadless
+    if (const char* frames = getenv("GFX_HEADLESS")) {
+        exit(runHeadless(max(atol(frames), 1L), getenv("GFX_HEADLESS_OUTPUT")));
+    }
+#endif
+
     // Alkalmaz�i ablak l�trehoz�sa
     glfwSetErrorCallback(error_callback);
     if (!glfwInit())
@@ -110,29 +349,101 @@ int main(void) {
     glfwSetMouseButtonCallback(window, mouse_button_callback);
     glfwSetCursorPosCallback(window, cursor_position_callback);
     glfwSetWindowRefreshCallback(window, window_refresh_callback);
+    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+    {
+        int width = windowWidth, height = windowHeight;
+        glfwGetFramebufferSize(window, &width, &height);
+        framebufferSize = FramebufferSize{width, height};
+    }
 
     glfwMakeContextCurrent(window);
     gladLoadGL();
-    glfwSwapInterval(1);
+    glfwSwapInterval(swapInterval);
+
+    // Hidden shared context for compiling shaders in the background
+    GLFWwindow* reloadContext = nullptr;
+    if (shaderHotReload) {
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+        reloadContext = glfwCreateWindow(1, 1, "", NULL, window);
+        glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+        if (reloadContext)
+            ShaderWatcher::instance().start(
+                [reloadContext](bool bind) {
+                    glfwMakeContextCurrent(bind ? reloadContext : NULL);
+                },
+                [] {
+                    screenRefresh = true;
+                    glfwPostEmptyEvent();
+                });
+    }
+
+    // Textures decoded in the background are uploaded at the next frame
+    TextureLoader::instance().setNotify([] {
+        screenRefresh = true;
+        glfwPostEmptyEvent();
+    });
 
     // Applik�ci� inicializ�l�sa
     pApp->onInitialization();
     float startTime = 0;
+    if (!captureDirectory.empty())
+        frameCapture = std::make_unique<FrameCapture>(captureDirectory);
+
+    if (renderThread) { // from now on the context belongs to the renderer
+        glfwMakeContextCurrent(NULL);
+        rendering = true;
+        renderer = std::thread(renderLoop);
+    }
 
     // �zenetkezel� hurok
     while (!glfwWindowShouldClose(window)) {
-        glfwPollEvents(); // esem�nyek lek�rdez�se �s reakci�
+        waitForEvents(); // esem�nyek lek�rdez�se �s reakci�
 
         const float endTime = (float)glfwGetTime(); // id� lek�rdez�se
         pApp->onTimeElapsed(startTime, endTime);    // anim�ci�
         startTime = endTime;
 
-        if (screenRefresh) {
-            pApp->onDisplay();       // rajzol�s
-            glfwSwapBuffers(window); // buffercsere
+        if (shaderHotReload && !rendering &&
+            ShaderWatcher::instance().applyPending())
+            screenRefresh = true; // rebuilt shader swapped in
+        if (!rendering && TextureLoader::instance().applyPending())
+            screenRefresh = true; // loaded texture uploaded
+
+        if (endTime >= nextFrameTime)
+            dispatchMotion(true); // late latched cursor position
+
+        if (screenRefresh && endTime >= nextFrameTime) {
             screenRefresh = false;
+            if (rendering) {
+                requestFrame();
+            } else {
+                renderPendingPoster();
+                pApp->onDisplay();       // rajzol�s
+                captureFrame();
+                glfwSwapBuffers(window); // buffercsere
+            }
+            // next frame slot; after a stall restart from now, not in a burst
+            nextFrameTime = frameInterval > 0
+                                ? max(nextFrameTime + frameInterval,
+                                      endTime + frameInterval * 0.5)
+                                : 0;
         }
     }
+    if (rendering) { // take the context back for the cleanup
+        rendering = false;
+        requestFrame();
+        renderer.join();
+        glfwMakeContextCurrent(window);
+    }
+    if (frameCapture) {
+        frameCapture->finish();
+        frameCapture.reset();
+    }
+    TextureLoader::instance().stop();
+    TextureManager::instance().clear();
+    ShaderWatcher::instance().stop();
+    if (reloadContext)
+        glfwDestroyWindow(reloadContext);
     glfwDestroyWindow(window);
     glfwTerminate();
     exit(EXIT_SUCCESS);
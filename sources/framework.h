@@ -1,15 +1,20 @@
 //=============================================================================================
 // OpenGL keretrendszer
 //=============================================================================================
+#ifndef FRAMEWORK_H
+#define FRAMEWORK_H
+
 #define GLAD_GL_IMPLEMENTATION
 #include <glad/glad.h>
 #define _USE_MATH_DEFINES // M_PI
 #define _CRT_SECURE_NO_WARNINGS
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <concepts>
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <string>
 #include <vector>
 
@@ -24,7 +29,16 @@ namespace fs = std::filesystem;
 namespace fs = std::filesystem;
 #    endif
 #    include "lodepng.h"
+#    include "PngStreamReader.h"
+#    include "ShaderLoader.h"
+#    include "ShaderWatcher.h"
+#    include "TextureCache.h"
+#    include "TextureLoader.h"
+#    include "TextureManager.h"
 #endif
+#include "GLState.h"
+#include "TextureImage.h"
+#include "VertexFormat.h"
 
 using namespace glm;
 
@@ -38,10 +52,27 @@ inline mat4 rotate(float angle, const vec3& v) {
 //---------------------------
 class GPUProgram {
     //--------------------------
+  public:
+#ifdef FILE_OPERATIONS
+    struct ShaderStage { // shader stage built from a file
+        GLenum type;
+        fs::path file;
+        std::vector<std::string> defines;
+        GLuint shader;
+    };
+#endif
+
+  private:
     GLuint shaderProgramId = 0;
     bool waitError = true;
+#ifdef FILE_OPERATIONS
+    std::vector<ShaderStage> stages;
+    // set by setUniformBlock(), applied again to a reloaded program
+    std::vector<std::pair<std::string, unsigned>> blockBindings;
+#endif
 
-    bool checkShader(unsigned int shader, std::string message) const {
+    bool checkShader(unsigned int shader, std::string message,
+                     bool wait) const {
         // shader ford�t�si hib�k kezel�se
         GLint infoLogLength = 0, result = 0;
         glGetShaderiv(shader, GL_COMPILE_STATUS, &result);
@@ -51,14 +82,14 @@ class GPUProgram {
             glGetShaderInfoLog(shader, infoLogLength, NULL,
                                (GLchar*)errorMessage.data());
             printf("%s! \n Log: \n%s\n", message.c_str(), errorMessage.c_str());
-            if (waitError)
+            if (wait)
                 getchar();
             return false;
         }
         return true;
     }
 
-    bool checkLinking(unsigned int program) const {
+    bool checkLinking(unsigned int program, bool wait) const {
         // shader szerkeszt�si hib�k kezel�se
         GLint infoLogLength = 0, result = 0;
         glGetProgramiv(program, GL_LINK_STATUS, &result);
@@ -69,7 +100,7 @@ class GPUProgram {
                                 (GLchar*)errorMessage.data());
             printf("Failed to link shader program! \n Log: \n%s\n",
                    errorMessage.c_str());
-            if (waitError)
+            if (wait)
                 getchar();
             return false;
         }
@@ -86,20 +117,40 @@ class GPUProgram {
     }
 
 #ifdef FILE_OPERATIONS
-    static std::string file2string(const fs::path& _fileName) {
-        std::string shaderCodeOut = "";
-        std::ifstream shaderStream(_fileName);
-        if (!shaderStream.is_open()) {
-            printf("Error while opening shader code file %s!",
-                   _fileName.string().c_str());
-            return "";
+    static std::string
+    file2string(const fs::path& _fileName,
+                const std::vector<std::string>& defines = {}) {
+        // mapped source with #include resolution and #define variants
+        return ShaderLoader::instance().load(_fileName, defines);
+    }
+
+    GLuint compileShader(GLenum shaderType, const fs::path& _fileName,
+                         const std::vector<std::string>& defines,
+                         bool wait) const {
+        // returns 0 on failure, exits only in interactive (wait) mode
+        const std::string shaderCode = file2string(_fileName, defines);
+        if (shaderCode.empty())
+            return 0;
+        const GLuint shaderID = glCreateShader(shaderType);
+        if (!shaderID) {
+            printf("Error in %s shader creation\n",
+                   shaderType2string(shaderType).c_str());
+            if (wait)
+                exit(1);
+            return 0;
         }
-        std::string line = "";
-        while (std::getline(shaderStream, line)) {
-            shaderCodeOut += line + "\n";
+        const char* sourcePointer = shaderCode.data();
+        const GLint sourceLength = static_cast<GLint>(shaderCode.length());
+        glShaderSource(shaderID, 1, &sourcePointer, &sourceLength);
+        glCompileShader(shaderID);
+        if (!checkShader(shaderID,
+                         shaderType2string(shaderType) + " shader error (" +
+                             _fileName.string() + ")",
+                         wait)) {
+            glDeleteShader(shaderID);
+            return 0;
         }
-        shaderStream.close();
-        return shaderCodeOut;
+        return shaderID;
     }
 #endif
 
@@ -150,7 +201,7 @@ class GPUProgram {
         glShaderSource(vertexShader, 1, (const GLchar**)&vertexShaderSource,
                        NULL);
         glCompileShader(vertexShader);
-        if (!checkShader(vertexShader, "Vertex shader error"))
+        if (!checkShader(vertexShader, "Vertex shader error", waitError))
             return;
 
         // Program l�trehoz�sa a forr�s sztringb�l, ha van geometria �rnyal�
@@ -164,7 +215,8 @@ class GPUProgram {
             glShaderSource(geometryShader, 1,
                            (const GLchar**)&geometryShaderSource, NULL);
             glCompileShader(geometryShader);
-            if (!checkShader(geometryShader, "Geometry shader error"))
+            if (!checkShader(geometryShader, "Geometry shader error",
+                             waitError))
                 return;
         }
 
@@ -178,7 +230,7 @@ class GPUProgram {
         glShaderSource(fragmentShader, 1, (const GLchar**)&fragmentShaderSource,
                        NULL);
         glCompileShader(fragmentShader);
-        if (!checkShader(fragmentShader, "Fragment shader error"))
+        if (!checkShader(fragmentShader, "Fragment shader error", waitError))
             return;
 
         shaderProgramId = glCreateProgram();
@@ -196,11 +248,37 @@ class GPUProgram {
             return;
 
         // Ez fusson
-        glUseProgram(shaderProgramId);
+        GLState::instance().useProgram(shaderProgramId);
+    }
+
+    void createCompute(const char* const computeShaderSource) {
+        // compute program from a source string, run with glDispatchCompute
+        const GLuint computeShader = glCreateShader(GL_COMPUTE_SHADER);
+        if (!computeShader) {
+            printf("Error in compute shader creation\n");
+            exit(1);
+        }
+        glShaderSource(computeShader, 1, (const GLchar**)&computeShaderSource,
+                       NULL);
+        glCompileShader(computeShader);
+        if (!checkShader(computeShader, "Compute shader error", waitError))
+            return;
+
+        shaderProgramId = glCreateProgram();
+        if (!shaderProgramId) {
+            printf("Error in shader program creation\n");
+            exit(-1);
+        }
+        glAttachShader(shaderProgramId, computeShader);
+        glDeleteShader(computeShader); // freed with the program
+        if (!link())
+            return;
+        GLState::instance().useProgram(shaderProgramId);
     }
 
 #ifdef FILE_OPERATIONS
-    bool addShader(const fs::path& _fileName) {
+    bool addShader(const fs::path& _fileName,
+                   const std::vector<std::string>& defines = {}) {
         GLenum shaderType = 0;
         const auto ext = _fileName.extension();
         if (ext == ".vert") {
@@ -219,36 +297,95 @@ class GPUProgram {
             printf("Unknown shader extension");
             return false;
         }
-        return addShader(shaderType, _fileName);
+        return addShader(shaderType, _fileName, defines);
     }
 
-    bool addShader(GLenum shaderType, const fs::path& _fileName) {
-        const std::string shaderCode = file2string(_fileName);
-        const GLuint shaderID = glCreateShader(shaderType);
-        if (!shaderID) {
-            printf("Error in vertex shader creation\n");
-            exit(1);
-        }
-        const char* sourcePointer = shaderCode.data();
-        const GLint sourceLength = static_cast<GLint>(shaderCode.length());
-        glShaderSource(shaderID, 1, &sourcePointer, &sourceLength);
-        glCompileShader(shaderID);
-        if (!checkShader(shaderID,
-                         shaderType2string(shaderType) + " shader error"))
+    bool addShader(GLenum shaderType, const fs::path& _fileName,
+                   const std::vector<std::string>& defines = {}) {
+        const GLuint shaderID =
+            compileShader(shaderType, _fileName, defines, waitError);
+        if (!shaderID)
             return false;
         if (shaderProgramId == 0)
             shaderProgramId = glCreateProgram();
         glAttachShader(shaderProgramId, shaderID);
+        {
+            const auto lock = ShaderWatcher::instance().lock();
+            stages.push_back({shaderType, _fileName, defines, shaderID});
+        }
+        ShaderWatcher::instance().watch(this); // hot reload, if enabled
         return true;
     }
+
+    const std::vector<ShaderStage>& Stages() const { return stages; }
+
+    GLuint rebuild(const std::vector<bool>& changed,
+                   std::vector<GLuint>& shaders) const {
+        // Builds a new program in the current (possibly background) context,
+        // recompiling only the changed stages and reusing the others.
+        // Returns 0 and releases everything it created on failure.
+        shaders.clear();
+        for (size_t i = 0; i < stages.size(); ++i) {
+            const ShaderStage& stage = stages[i];
+            GLuint shader = stage.shader;
+            if (changed[i])
+                shader = compileShader(stage.type, stage.file, stage.defines,
+                                       false);
+            if (!shader) {
+                for (size_t j = 0; j < shaders.size(); ++j)
+                    if (shaders[j] != stages[j].shader)
+                        glDeleteShader(shaders[j]);
+                shaders.clear();
+                return 0;
+            }
+            shaders.push_back(shader);
+        }
+        const GLuint program = glCreateProgram();
+        for (const GLuint shader : shaders)
+            glAttachShader(program, shader);
+        glLinkProgram(program);
+        if (!checkLinking(program, false)) {
+            glDeleteProgram(program);
+            for (size_t i = 0; i < shaders.size(); ++i)
+                if (shaders[i] != stages[i].shader)
+                    glDeleteShader(shaders[i]);
+            shaders.clear();
+            return 0;
+        }
+        return program;
+    }
+
+    void replace(GLuint program, const std::vector<GLuint>& shaders) {
+        // Swaps in a program produced by rebuild(); the old one is released.
+        GLint current = 0;
+        glGetIntegerv(GL_CURRENT_PROGRAM, &current);
+        for (size_t i = 0; i < stages.size(); ++i) {
+            if (stages[i].shader != shaders[i]) {
+                glDeleteShader(stages[i].shader);
+                stages[i].shader = shaders[i];
+            }
+        }
+        if (shaderProgramId > 0)
+            GLState::instance().deleteProgram(shaderProgramId);
+        if (current != 0 && static_cast<GLuint>(current) == shaderProgramId)
+            GLState::instance().useProgram(program);
+        shaderProgramId = program;
+        for (const auto& [name, binding] : blockBindings) {
+            const GLuint index = glGetUniformBlockIndex(program, name.c_str());
+            if (index != GL_INVALID_INDEX)
+                glUniformBlockBinding(program, index, binding);
+        }
+    }
 #endif
 
     bool link() {
         glLinkProgram(shaderProgramId);
-        return checkLinking(shaderProgramId);
+        return checkLinking(shaderProgramId, waitError);
     }
 
-    void Use() const { glUseProgram(shaderProgramId); } // make this program run
+    void Use() const { // make this program run
+        GLState::instance().useProgram(shaderProgramId);
+    }
 
     void setUniform(int i, const std::string& name) {
         const int location = getLocation(name);
@@ -286,9 +423,34 @@ class GPUProgram {
             glUniformMatrix4fv(location, 1, GL_FALSE, &mat[0][0]);
     }
 
+    void setUniformBlock(const std::string& name, unsigned binding) {
+        // reads the uniform block from the buffer at a binding point
+        const GLuint index =
+            glGetUniformBlockIndex(shaderProgramId, name.c_str());
+        if (index == GL_INVALID_INDEX) {
+            printf("uniform block %s cannot be set\n", name.c_str());
+            return;
+        }
+        glUniformBlockBinding(shaderProgramId, index, binding);
+#ifdef FILE_OPERATIONS
+        for (auto& [block, point] : blockBindings) {
+            if (block == name) {
+                point = binding;
+                return;
+            }
+        }
+        blockBindings.emplace_back(name, binding);
+#endif
+    }
+
     ~GPUProgram() {
+#ifdef FILE_OPERATIONS
+        ShaderWatcher::instance().unwatch(this);
+        for (const ShaderStage& stage : stages)
+            glDeleteShader(stage.shader);
+#endif
         if (shaderProgramId > 0)
-            glDeleteProgram(shaderProgramId);
+            GLState::instance().deleteProgram(shaderProgramId);
     }
 };
 
@@ -296,44 +458,82 @@ class GPUProgram {
 template <class T>
 class Geometry {
     //---------------------------
-    unsigned int vao, vbo; // GPU
+    unsigned int vao, vbo, ebo = 0; // GPU
   protected:
     std::vector<T> vtx; // CPU
+    std::vector<unsigned int> idx; // CPU, elements of vtx in indexed mode
   public:
     Geometry() {
         glGenVertexArrays(1, &vao);
-        glBindVertexArray(vao);
+        GLState::instance().bindVertexArray(vao);
         glGenBuffers(1, &vbo);
-        glBindBuffer(GL_ARRAY_BUFFER, vbo);
-        glEnableVertexAttribArray(0);
-        const int nf = min((int)(sizeof(T) / sizeof(float)), 4);
-        glVertexAttribPointer(0, nf, GL_FLOAT, GL_FALSE, 0, NULL);
+        GLState::instance().bindBuffer(GL_ARRAY_BUFFER, vbo);
+        setVertexFormat<T>(); // attributes from VertexFormat<T>
     }
 
     std::vector<T>& Vtx() { return vtx; }
+    const std::vector<T>& Vtx() const { return vtx; }
+    // with indices, primitives are built from the vertices they pick
+    std::vector<unsigned int>& Idx() { return idx; }
 
     void updateGPU() {
         // CPU -> GPU
-        glBindBuffer(GL_ARRAY_BUFFER, vbo);
+        GLState::instance().bindBuffer(GL_ARRAY_BUFFER, vbo);
         glBufferData(GL_ARRAY_BUFFER, vtx.size() * sizeof(T), &vtx[0],
                      GL_DYNAMIC_DRAW);
+        updateIndices();
+    }
+
+    void updateIndices() {
+        // CPU -> GPU, the indices only: the vertices are left as they are
+        if (idx.empty())
+            return;
+        if (ebo == 0)
+            glGenBuffers(1, &ebo);
+        GLState::instance().bindVertexArray(vao); // the EBO belongs to it
+        GLState::instance().bindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, idx.size() * sizeof(unsigned),
+                     &idx[0], GL_DYNAMIC_DRAW);
     }
 
     void Bind() const {
-        glBindVertexArray(vao);
-        glBindBuffer(GL_ARRAY_BUFFER, vbo);
+        GLState::instance().bindVertexArray(vao);
+        GLState::instance().bindBuffer(GL_ARRAY_BUFFER, vbo);
     } // aktiv�l�s
     void Draw(GPUProgram* prog, int type, vec3 color) {
         if (vtx.size() > 0) {
             prog->setUniform(color, "color");
-            glBindVertexArray(vao);
-            glDrawArrays(type, 0, (int)vtx.size());
+            GLState::instance().bindVertexArray(vao);
+            if (idx.empty())
+                glDrawArrays(type, 0, (int)vtx.size());
+            else
+                glDrawElements(type, (int)idx.size(), GL_UNSIGNED_INT, NULL);
         }
     }
 
+    // draws count vertices from first, with the uniforms already set
+    void DrawRange(int type, int first, int count) const {
+        GLState::instance().bindVertexArray(vao);
+        glDrawArrays(type, first, count);
+    }
+
+    // draws count vertices per instance, with the uniforms already set
+    void DrawInstanced(int type, int count, int instanceCount) const {
+        GLState::instance().bindVertexArray(vao);
+        glDrawArraysInstanced(type, 0, count, instanceCount);
+    }
+
+    // draws the records of the bound GL_DRAW_INDIRECT_BUFFER, uniforms set
+    void DrawIndirect(int type, int drawCount) const {
+        GLState::instance().bindVertexArray(vao);
+        glMultiDrawArraysIndirect(type, nullptr, drawCount, 0);
+    }
+
     virtual ~Geometry() {
-        glDeleteBuffers(1, &vbo);
-        glDeleteVertexArrays(1, &vao);
+        if (ebo > 0)
+            GLState::instance().deleteBuffers(1, &ebo);
+        GLState::instance().deleteBuffers(1, &vbo);
+        GLState::instance().deleteVertexArrays(1, &vao);
     }
 };
 
@@ -341,80 +541,129 @@ class Geometry {
 class Texture {
     //---------------------------
     unsigned int textureId = 0;
+    std::size_t byteSize = 0; // GPU memory of all levels
+    friend class TextureLoader; // uploads images decoded in the background
+
+    // 8-bit texels instead of floats, R8/RG8/RGBA8 whichever fits
+    void create(const TextureImage& texels, int sampling) {
+        glGenTextures(1, &textureId);                // azonos�t� gener�l�sa
+        GLState& state = GLState::instance();
+        state.bindTexture(GL_TEXTURE_2D, textureId); // ez az akt�v innent�l
+        texels.upload(sampling, texels.texels.data()); // To GPU
+        byteSize = texels.byteSize();
+    }
+
+    void create(int width, int height, const std::vector<vec3>& image) {
+        create(TextureImage::fromFloatRgb(&image[0].x, width, height),
+               GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    }
+
+    static void toRgba8(const vec4& colour, unsigned char* rgba) {
+        for (int i = 0; i < 4; i++)
+            rgba[i] = (unsigned char)(clamp(colour[i], 0.0f, 1.0f) * 255.0f +
+                                      0.5f);
+    }
+
+    static void toRgba8(const vec3& colour, unsigned char* rgba) {
+        toRgba8(vec4(colour, 1.0f), rgba);
+    }
 
   public:
 #ifdef FILE_OPERATIONS
+    // Loads synchronously; TextureLoader::load decodes in the background
     Texture(const fs::path pathname, bool transparent = false,
             int sampling = GL_LINEAR) {
         if (textureId == 0)
             glGenTextures(1, &textureId);        // azonos�t� gener�l�s
-        glBindTexture(GL_TEXTURE_2D, textureId); // k�t�s
-        unsigned int width, height;
-        unsigned char* pixels;
-        if (transparent) {
-            lodepng_decode32_file(&pixels, &width, &height,
-                                  pathname.string().c_str());
-            for (int y = 0; y < height; ++y) {
-                for (int x = 0; x < width; ++x) {
-                    float sum = 0;
-                    for (int c = 0; c < 3; ++c) {
-                        sum += pixels[4 * (x + y * width) + c];
-                    }
-                    pixels[4 * (x + y * width) + 3] = sum / 6;
-                }
-            }
-
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA,
-                         GL_UNSIGNED_BYTE, pixels); // GPU-ra
-        } else {
-            lodepng_decode24_file(&pixels, &width, &height,
-                                  pathname.string().c_str());
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB,
-                         GL_UNSIGNED_BYTE, pixels); // GPU-ra
+        GLState::instance().bindTexture(GL_TEXTURE_2D, textureId); // k�t�s
+        unsigned int width = 0, height = 0;
+        const unsigned flags =
+            transparent ? unsigned(TextureCache::ALPHA_FROM_COLOUR) : 0u;
+        if (auto cached = TextureCache::instance().find(pathname, flags)) {
+            width = cached->layout.getWidth(); // no decoding at all
+            height = cached->layout.getHeight();
+            cached->layout.upload(sampling, cached->texels);
+            byteSize = cached->layout.byteSize();
+            printf("%s, w: %d, h: %d\n", pathname.string().c_str(), width,
+                   height);
+            return;
+        }
+        std::vector<unsigned char> pixels; // streamed, with room for mips
+        const unsigned error = PngStreamReader::decodeFile(
+            pixels, width, height, pathname, false, true);
+        if (error) {
+            printf("%s: %s\n", pathname.string().c_str(),
+                   lodepng_error_text(error));
+            return;
         }
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
-                        sampling); // sz�r�s
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, sampling);
+        // alpha from the colour if transparent, narrowed in place
+        TextureImage image = TextureImage::fromRgba8(std::move(pixels), width,
+                                                     height, transparent);
+        image.generateMipmaps();
+        TextureCache::instance().store(pathname, flags, image);
+        image.upload(sampling, image.texels.data()); // GPU-ra
+        byteSize = image.byteSize();
         printf("%s, w: %d, h: %d\n", pathname.string().c_str(), width, height);
     }
 #endif
     Texture(int width, int height) {
-        glGenTextures(1, &textureId);            // azonos�t� gener�l�sa
-        glBindTexture(GL_TEXTURE_2D, textureId); // ez az akt�v innent�l
         // procedur�lis text�ra el��ll�t�sa programmal
-        const vec3 yellow(1, 1, 0), blue(0, 0, 1);
-        std::vector<vec3> image(width * height);
-        for (int x = 0; x < width; x++)
-            for (int y = 0; y < height; y++) {
-                image[y * width + x] = (x & 1) ^ (y & 1) ? yellow : blue;
-            }
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB,
-                     GL_FLOAT,
-                     &image[0]); // To GPU
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
-                        GL_NEAREST); // sampling
+        static const unsigned char yellow[4] = {255, 255, 0, 255};
+        static const unsigned char blue[4] = {0, 0, 255, 255};
+        // row by row on several threads, straight to 8-bit texels
+        create(TextureImage::generate(
+                   width, height,
+                   [width](unsigned y, unsigned count, unsigned char* rgba) {
+                       for (unsigned row = y; row < y + count; row++)
+                           for (int x = 0; x < width; x++, rgba += 4)
+                               memcpy(rgba, (x ^ row) & 1 ? yellow : blue, 4);
+                   }),
+               GL_NEAREST);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     }
 
+    // procedural texture: texel(x, y) returns a vec3 or vec4 in [0, 1], and
+    // is called on several threads
+    template <typename Texel>
+        requires std::invocable<const Texel&, int, int>
+    Texture(int width, int height, const Texel& texel,
+            int sampling = GL_LINEAR) {
+        TextureImage image = TextureImage::generate(
+            width, height,
+            [&](unsigned y, unsigned count, unsigned char* rgba) {
+                for (int row = (int)y; row < int(y + count); row++)
+                    for (int x = 0; x < width; x++, rgba += 4)
+                        toRgba8(texel(x, row), rgba);
+            });
+        image.generateMipmaps();
+        create(image, sampling);
+    }
+
+    // procedural texture computed on the GPU, texel is GLSL source of
+    // vec4 texel(ivec2 position, ivec2 size); needs OpenGL 4.3
+    Texture(int width, int height, const char* texel,
+            int sampling = GL_LINEAR) {
+        glGenTextures(1, &textureId);
+        GLState::instance().bindTexture(GL_TEXTURE_2D, textureId);
+        byteSize = TextureImage::generateOnGpu(width, height, texel, sampling);
+    }
+
     Texture(int width, int height, std::vector<vec3>& image) {
-        glGenTextures(1, &textureId);            // azonos�t� gener�l�sa
-        glBindTexture(GL_TEXTURE_2D, textureId); // ez az akt�v innent�l
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB,
-                     GL_FLOAT,
-                     &image[0]); // To GPU
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
-                        GL_NEAREST); // sampling
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        create(width, height, image);
     }
 
     void Bind(int textureUnit) const {
-        glActiveTexture(GL_TEXTURE0 + textureUnit); // aktiv�l�s
-        glBindTexture(GL_TEXTURE_2D, textureId);    // piros ny�l
+        GLState& state = GLState::instance();
+        state.activeTexture(textureUnit);            // aktiv�l�s
+        state.bindTexture(GL_TEXTURE_2D, textureId); // piros ny�l
     }
 
+    [[nodiscard]] std::size_t getByteSize() const { return byteSize; }
+
     ~Texture() {
         if (textureId > 0)
-            glDeleteTextures(1, &textureId);
+            GLState::instance().deleteTextures(1, &textureId);
     }
 };
 
@@ -443,6 +692,18 @@ class glApp {
           unsigned int winHeight, // Alkalmaz�i ablak felbont�sa
           const char* caption);   // Megfog�cs�k sz�vege
     static void refreshScreen();  // Ablak �rv�nytelen�t�se
+    static void watchShaders(bool enable); // shader hot reload (inotify)
+    // Frame pacing
+    static void setEventDriven(bool enable);   // sleep while idle
+    static void setAnimating(bool enable);     // render continuously
+    static void setCoalesceMotion(bool enable); // one motion event per frame
+    static void setSwapInterval(int interval); // vsync: 0 off, 1 on, -1 adaptive
+    static void setFrameRateLimit(double fps); // 0: unlimited
+    static void setRenderThread(bool enable);  // onDisplay on its own thread
+    static void captureFrames(const char* directory); // PNG frame sequence
+    // Tiled rendering of images larger than the window
+    static const mat4& viewTransform(); // apply after the vertex transform
+    static void renderPoster(const char* file, unsigned width, unsigned height);
     // Esem�nykezel�k
     virtual void onInitialization() {}    // Inicializ�ci�
     virtual void onDisplay() {}           // Ablak �rv�nytelen
@@ -459,3 +720,5 @@ class glApp {
     // Telik az id�
     virtual void onTimeElapsed(float startTime, float endTime) {}
 };
+
+#endif
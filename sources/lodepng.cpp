@@ -40,6 +40,21 @@ C.
 #    include <stdlib.h> /* allocations */
 #endif                  /* LODEPNG_COMPILE_ALLOCATORS */
 
+/*SSE2 unfiltering, with AVX2 chosen at runtime where the compiler supports it.
+Pass -DLODEPNG_NO_COMPILE_SIMD to the compiler to use only the portable code.*/
+#if !defined(LODEPNG_NO_COMPILE_SIMD) &&                                       \
+    (defined(__SSE2__) || defined(_M_X64) ||                                   \
+     (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#    define LODEPNG_COMPILE_SIMD
+#    include <emmintrin.h>
+#    include <string.h> /* memcpy of 3 and 4 byte pixels */
+#    if (defined(__GNUC__) || defined(__clang__)) &&                           \
+        (defined(__x86_64__) || defined(__i386__))
+#        include <immintrin.h>
+#        define LODEPNG_COMPILE_AVX2
+#    endif
+#endif /* LODEPNG_NO_COMPILE_SIMD */
+
 #if defined(_MSC_VER) &&                                                       \
     (_MSC_VER >=                                                               \
      1310) /*Visual Studio: A few warning types are not desired here.*/
@@ -1475,6 +1490,311 @@ static unsigned getTreeInflateDynamic(HuffmanTree* tree_ll, HuffmanTree* tree_d,
 }
 
 /*inflate a block with dynamic of fixed Huffman tree. btype must be 1 or 2.*/
+#        ifndef LODEPNG_NO_COMPILE_FAST_INFLATE
+/*
+Fast path of inflateHuffmanBlock. Pass -DLODEPNG_NO_COMPILE_FAST_INFLATE to the
+compiler to use only the bit reader based loop.
+
+It keeps a 64-bit bit buffer that is refilled with one unaligned 8 byte read
+per step, enough for a length, a distance and their extra bits, or for two
+literal entries. Codes are decoded through a table of FAST_ROOTBITS bits with
+subtables for longer codes; a root entry can hold two literals when both codes
+fit in the root bits. Back-references with a distance of 8 or more are copied
+8 bytes at a time. It runs while at least 8 input bytes are left and the
+output is not close to max_output_size, and stops in front of anything unusual
+(invalid or disallowed symbols, too long distances) so the bit reader based
+loop continues from the same symbol and reports the same errors.
+*/
+
+#            define FAST_ROOTBITS 10u
+#            define FAST_OUT_MARGIN 272u /*max match length + an 8 byte copy*/
+
+/*entry layout: bits 0-7 code length in bits (for a subtable entry: its index
+bits), bits 8-10 kind, bits 16-31 payload*/
+#            define FAST_INVALID 0u
+#            define FAST_LITERAL 1u  /*payload: the literal*/
+#            define FAST_LITERAL2 2u /*payload: two literals, low byte first*/
+#            define FAST_SYMBOL 3u   /*payload: length or distance index*/
+#            define FAST_END 4u
+#            define FAST_SUBTABLE 5u /*payload: offset of the subtable*/
+#            define FAST_ENTRY(len, kind, payload)                             \
+                ((unsigned)(len) | ((unsigned)(kind) << 8u) |                  \
+                 ((unsigned)(payload) << 16u))
+#            define FAST_LEN(e) ((e) & 255u)
+#            define FAST_KIND(e) (((e) >> 8u) & 7u)
+#            define FAST_PAYLOAD(e) ((e) >> 16u)
+
+static LODEPNG_INLINE unsigned long long
+lodepng_read64bitIntLE(const unsigned char* p) {
+    return (unsigned long long)p[0] | ((unsigned long long)p[1] << 8u) |
+           ((unsigned long long)p[2] << 16u) |
+           ((unsigned long long)p[3] << 24u) |
+           ((unsigned long long)p[4] << 32u) |
+           ((unsigned long long)p[5] << 40u) |
+           ((unsigned long long)p[6] << 48u) |
+           ((unsigned long long)p[7] << 56u);
+}
+
+static LODEPNG_INLINE void lodepng_copy8(unsigned char* dst,
+                                         const unsigned char* src) {
+    const unsigned long long v = lodepng_read64bitIntLE(src);
+    unsigned i;
+    for (i = 0; i != 8; ++i)
+        dst[i] = (unsigned char)(v >> (8u * i));
+}
+
+/*entry for symbol s of a literal/length (litlen) or distance alphabet*/
+static unsigned fastEntry(unsigned s, unsigned len, int litlen) {
+    if (!litlen)
+        return s <= 29 ? FAST_ENTRY(len, FAST_SYMBOL, s)
+                       : FAST_ENTRY(len, FAST_INVALID, 0);
+    if (s <= 255)
+        return FAST_ENTRY(len, FAST_LITERAL, s);
+    if (s == 256)
+        return FAST_ENTRY(len, FAST_END, 0);
+    if (s <= LAST_LENGTH_CODE_INDEX)
+        return FAST_ENTRY(len, FAST_SYMBOL, s - FIRST_LENGTH_CODE_INDEX);
+    return FAST_ENTRY(len, FAST_INVALID, 0);
+}
+
+/*builds the lookup table of a tree. Returns 0 on success, 83 if allocation
+failed, 1 if the code is not usable by the fast path*/
+static unsigned makeFastTable(unsigned** table, const HuffmanTree* tree,
+                              int litlen) {
+    const size_t headsize = (size_t)1u << FAST_ROOTBITS;
+    unsigned maxlens[1u << FAST_ROOTBITS];
+    unsigned* entries;
+    size_t size = headsize, pointer = headsize, i, j;
+
+    for (i = 0; i != headsize; ++i)
+        maxlens[i] = 0;
+    for (i = 0; i != tree->numcodes; ++i) {
+        const unsigned l = tree->lengths[i];
+        if (l > FAST_ROOTBITS) {
+            const unsigned prefix =
+                reverseBits(tree->codes[i] >> (l - FAST_ROOTBITS),
+                            FAST_ROOTBITS);
+            if (l > maxlens[prefix])
+                maxlens[prefix] = l;
+        }
+    }
+    for (i = 0; i != headsize; ++i)
+        if (maxlens[i])
+            size += (size_t)1u << (maxlens[i] - FAST_ROOTBITS);
+    entries = (unsigned*)lodepng_malloc(size * sizeof(unsigned));
+    if (!entries)
+        return 83; /*alloc fail*/
+    for (i = 0; i != size; ++i)
+        entries[i] = FAST_ENTRY(1, FAST_INVALID, 0);
+    for (i = 0; i != headsize; ++i) {
+        if (maxlens[i]) {
+            entries[i] = FAST_ENTRY(maxlens[i] - FAST_ROOTBITS,
+                                    FAST_SUBTABLE, pointer);
+            pointer += (size_t)1u << (maxlens[i] - FAST_ROOTBITS);
+        }
+    }
+
+    for (i = 0; i != tree->numcodes; ++i) {
+        const unsigned l = tree->lengths[i];
+        unsigned reverse, entry;
+        if (l == 0)
+            continue;
+        reverse = reverseBits(tree->codes[i], l);
+        entry = fastEntry((unsigned)i, l, litlen);
+        if (l <= FAST_ROOTBITS) {
+            for (j = reverse; j < headsize; j += (size_t)1u << l) {
+                if (FAST_KIND(entries[j]) == FAST_SUBTABLE)
+                    break; /*over-subscribed code*/
+                entries[j] = entry;
+            }
+            if (j < headsize)
+                break;
+        } else {
+            const unsigned head = entries[reverse & (headsize - 1u)];
+            const size_t subsize = (size_t)1u << FAST_LEN(head);
+            if (FAST_KIND(head) != FAST_SUBTABLE)
+                break; /*over-subscribed code*/
+            for (j = reverse >> FAST_ROOTBITS; j < subsize;
+                 j += (size_t)1u << (l - FAST_ROOTBITS))
+                entries[FAST_PAYLOAD(head) + j] = entry;
+        }
+    }
+    if (i != tree->numcodes) {
+        lodepng_free(entries);
+        return 1;
+    }
+
+    if (litlen) { /*pair up literals whose codes both fit in the root bits*/
+        unsigned single[1u << FAST_ROOTBITS];
+        lodepng_memcpy(single, entries, sizeof(single));
+        for (i = 0; i != headsize; ++i) {
+            const unsigned first = single[i], l = FAST_LEN(first);
+            unsigned second;
+            if (FAST_KIND(first) != FAST_LITERAL || l >= FAST_ROOTBITS)
+                continue;
+            second = single[i >> l];
+            if (FAST_KIND(second) == FAST_LITERAL &&
+                FAST_LEN(second) <= FAST_ROOTBITS - l)
+                entries[i] = FAST_ENTRY(
+                    l + FAST_LEN(second), FAST_LITERAL2,
+                    FAST_PAYLOAD(first) | (FAST_PAYLOAD(second) << 8u));
+        }
+    }
+    *table = entries;
+    return 0;
+}
+
+/*looks up the entry for the next code; bitbuf must hold at least 15 bits*/
+static LODEPNG_INLINE unsigned fastLookup(const unsigned* table,
+                                          unsigned long long bitbuf) {
+    const unsigned entry =
+        table[bitbuf & ((1u << FAST_ROOTBITS) - 1u)];
+    if (FAST_KIND(entry) != FAST_SUBTABLE)
+        return entry;
+    return table[FAST_PAYLOAD(entry) +
+                 ((unsigned)(bitbuf >> FAST_ROOTBITS) &
+                  ((1u << FAST_LEN(entry)) - 1u))];
+}
+
+/*decodes symbols of a block until its end, the end of the fast region or
+anything the bit reader based loop must handle. Sets *done at the end code.*/
+static unsigned inflateHuffmanBlockFast(ucvector* out,
+                                        LodePNGBitReader* reader,
+                                        const HuffmanTree* tree_ll,
+                                        const HuffmanTree* tree_d,
+                                        size_t max_output_size, int* done) {
+    const unsigned char* in = reader->data + (reader->bp >> 3u);
+    const unsigned char* const in_end = reader->data + reader->size;
+    unsigned long long bitbuf = 0;
+    unsigned bitsleft = 0;
+    unsigned* table_ll = 0;
+    unsigned* table_d = 0;
+    unsigned error;
+
+    if (in_end - in < 8)
+        return 0;
+    error = makeFastTable(&table_ll, tree_ll, 1);
+    if (!error)
+        error = makeFastTable(&table_d, tree_d, 0);
+    if (error) {
+        lodepng_free(table_ll);
+        return error == 1 ? 0 : error;
+    }
+
+#            define FAST_REFILL()                                              \
+                {                                                              \
+                    bitbuf |= lodepng_read64bitIntLE(in) << bitsleft;          \
+                    in += (63u - bitsleft) >> 3u;                              \
+                    bitsleft |= 56u;                                           \
+                }
+#            define FAST_CONSUME(n)                                            \
+                {                                                              \
+                    bitbuf >>= (n);                                            \
+                    bitsleft -= (n);                                           \
+                }
+
+    FAST_REFILL();
+    FAST_CONSUME(reader->bp & 7u);
+    while (in_end - in >= 8) {
+        unsigned long long saved_bitbuf;
+        unsigned saved_bitsleft, entry, extra, kind;
+        size_t length, distance;
+        unsigned char *dst, *end;
+        const unsigned char* src;
+
+        if (out->allocsize - out->size < FAST_OUT_MARGIN &&
+            !ucvector_reserve(out, out->size + FAST_OUT_MARGIN)) {
+            error = 83; /*alloc fail*/
+            break;
+        }
+        if (max_output_size && out->size + FAST_OUT_MARGIN > max_output_size)
+            break; /*the slow loop reports the limit*/
+        FAST_REFILL();
+        saved_bitbuf = bitbuf; /*to step back over a length code*/
+        saved_bitsleft = bitsleft;
+
+        entry = fastLookup(table_ll, bitbuf);
+        kind = FAST_KIND(entry);
+        if (kind == FAST_LITERAL || kind == FAST_LITERAL2) {
+            /*the refill leaves enough bits for two such entries*/
+            dst = out->data + out->size;
+            FAST_CONSUME(FAST_LEN(entry));
+            dst[0] = (unsigned char)FAST_PAYLOAD(entry);
+            dst[1] = (unsigned char)(FAST_PAYLOAD(entry) >> 8u);
+            dst += kind;
+            entry = fastLookup(table_ll, bitbuf);
+            kind = FAST_KIND(entry);
+            if (kind == FAST_LITERAL || kind == FAST_LITERAL2) {
+                FAST_CONSUME(FAST_LEN(entry));
+                dst[0] = (unsigned char)FAST_PAYLOAD(entry);
+                dst[1] = (unsigned char)(FAST_PAYLOAD(entry) >> 8u);
+                dst += kind;
+            }
+            out->size = (size_t)(dst - out->data);
+            continue;
+        }
+        if (kind == FAST_END) {
+            FAST_CONSUME(FAST_LEN(entry));
+            *done = 1;
+            break;
+        }
+        if (kind != FAST_SYMBOL)
+            break;
+
+        FAST_CONSUME(FAST_LEN(entry));
+        extra = LENGTHEXTRA[FAST_PAYLOAD(entry)];
+        length = LENGTHBASE[FAST_PAYLOAD(entry)] +
+                 (unsigned)(bitbuf & ((1u << extra) - 1u));
+        FAST_CONSUME(extra);
+
+        entry = fastLookup(table_d, bitbuf);
+        if (FAST_KIND(entry) != FAST_SYMBOL) {
+            bitbuf = saved_bitbuf; /*let the slow loop report it*/
+            bitsleft = saved_bitsleft;
+            break;
+        }
+        FAST_CONSUME(FAST_LEN(entry));
+        extra = DISTANCEEXTRA[FAST_PAYLOAD(entry)];
+        distance = DISTANCEBASE[FAST_PAYLOAD(entry)] +
+                   (unsigned)(bitbuf & ((1u << extra) - 1u));
+        FAST_CONSUME(extra);
+        if (distance > out->size) {
+            bitbuf = saved_bitbuf;
+            bitsleft = saved_bitsleft;
+            break;
+        }
+
+        dst = out->data + out->size;
+        src = dst - distance;
+        end = dst + length;
+        out->size += length;
+        if (distance >= 8) {
+            do {
+                lodepng_copy8(dst, src);
+                dst += 8;
+                src += 8;
+            } while (dst < end);
+        } else if (distance == 1) {
+            const unsigned char value = *src;
+            do
+                *dst++ = value;
+            while (dst < end);
+        } else {
+            do
+                *dst++ = *src++;
+            while (dst < end);
+        }
+    }
+#            undef FAST_REFILL
+#            undef FAST_CONSUME
+
+    reader->bp = (size_t)(in - reader->data) * 8u - bitsleft;
+    lodepng_free(table_ll);
+    lodepng_free(table_d);
+    return error;
+}
+#        endif /* LODEPNG_NO_COMPILE_FAST_INFLATE */
+
 static unsigned inflateHuffmanBlock(ucvector* out, LodePNGBitReader* reader,
                                     unsigned btype, size_t max_output_size) {
     unsigned error = 0;
@@ -1496,6 +1816,14 @@ static unsigned inflateHuffmanBlock(ucvector* out, LodePNGBitReader* reader,
     else /*if(btype == 2)*/
         error = getTreeInflateDynamic(&tree_ll, &tree_d, reader);
 
+#        ifndef LODEPNG_NO_COMPILE_FAST_INFLATE
+    if (!error)
+        error = inflateHuffmanBlockFast(out, reader, &tree_ll, &tree_d,
+                                        max_output_size, &done);
+    if (!error && !ucvector_reserve(out, out->size + reserved_size))
+        error = 83; /*alloc fail*/
+#        endif
+
     while (!error &&
            !done) /*decode all symbols until end reached, breaks at end code*/ {
         /*code_ll is literal, length or end code*/
@@ -2542,6 +2870,101 @@ unsigned lodepng_deflate(unsigned char** out, size_t* outsize,
     return error;
 }
 
+/*Insert the bytes in[start..end-1] into the hash chains without encoding them,
+so that following data can refer back to them (preset dictionary).*/
+static void hash_prime(Hash* hash, const unsigned char* in, size_t start,
+                       size_t end, size_t insize, unsigned windowsize) {
+    size_t pos;
+    unsigned numzeros = 0;
+    for (pos = start; pos < end; ++pos) {
+        const unsigned hashval = getHash(in, insize, pos);
+        if (hashval == 0) {
+            if (numzeros == 0)
+                numzeros = countZeros(in, insize, pos);
+            else if (pos + numzeros > insize || in[pos + numzeros - 1] != 0)
+                --numzeros;
+        } else {
+            numzeros = 0;
+        }
+        updateHashChain(hash, pos & (windowsize - 1), hashval,
+                        (unsigned short)numzeros);
+    }
+}
+
+unsigned lodepng_deflate_chunk(unsigned char** out, size_t* outsize,
+                               const unsigned char* in, size_t dictsize,
+                               size_t insize,
+                               const LodePNGCompressSettings* settings,
+                               unsigned final) {
+    ucvector v = ucvector_init(*out, *outsize);
+    unsigned error = 0;
+    size_t i, blocksize, numdeflateblocks;
+    const size_t datasize = insize - dictsize;
+    Hash hash;
+    LodePNGBitWriter writer;
+
+    if (dictsize > insize)
+        return 48; /*the dictionary can not be larger than the input*/
+    if (settings->btype != 1 && settings->btype != 2)
+        return 61; /*only compressed blocks can be primed and flushed*/
+
+    LodePNGBitWriter_init(&writer, &v);
+
+    if (settings->btype == 1) {
+        blocksize = datasize;
+    } else {
+        /*same block sizes as lodepng_deflatev*/
+        blocksize = datasize / 8u + 8;
+        if (blocksize < 65536)
+            blocksize = 65536;
+        if (blocksize > 262144)
+            blocksize = 262144;
+    }
+    numdeflateblocks = datasize == 0 ? 1 : (datasize + blocksize - 1) / blocksize;
+
+    error = hash_init(&hash, settings->windowsize);
+    if (!error && dictsize > 0) {
+        const size_t dictstart =
+            dictsize > settings->windowsize ? dictsize - settings->windowsize
+                                            : 0;
+        hash_prime(&hash, in, dictstart, dictsize, insize,
+                   settings->windowsize);
+    }
+
+    for (i = 0; i != numdeflateblocks && !error; ++i) {
+        const unsigned last = final && (i == numdeflateblocks - 1);
+        const size_t start = dictsize + i * blocksize;
+        size_t end = start + blocksize;
+        if (end > insize)
+            end = insize;
+        if (settings->btype == 1 || start == end)
+            error = deflateFixed(&writer, &hash, in, start, end, settings, last);
+        else
+            error = deflateDynamic(&writer, &hash, in, start, end, settings,
+                                   last);
+    }
+
+    if (!error && !final) {
+        /*sync flush: an empty stored block ends the output on a byte boundary,
+         * so the next chunk can be appended directly*/
+        writeBits(&writer, 0, 1); /*BFINAL*/
+        writeBits(&writer, 0, 2); /*BTYPE 00*/
+        if (!ucvector_resize(&v, v.size + 4))
+            error = 83; /*alloc fail*/
+        else {
+            v.data[v.size - 4] = 0; /*LEN*/
+            v.data[v.size - 3] = 0;
+            v.data[v.size - 2] = 255; /*NLEN*/
+            v.data[v.size - 1] = 255;
+        }
+    }
+
+    hash_cleanup(&hash);
+    *out = v.data;
+    *outsize = v.size;
+    return error;
+}
+
 static unsigned deflate(unsigned char** out, size_t* outsize,
                         const unsigned char* in, size_t insize,
                         const LodePNGCompressSettings* settings) {
@@ -2589,6 +3012,17 @@ static unsigned adler32(const unsigned char* data, unsigned len) {
     return update_adler32(1u, data, len);
 }
 
+unsigned lodepng_update_adler32(unsigned adler, const unsigned char* data,
+                                size_t len) {
+    while (len > 0) {
+        const unsigned amount = len > 0x40000000u ? 0x40000000u : (unsigned)len;
+        adler = update_adler32(adler, data, amount);
+        data += amount;
+        len -= amount;
+    }
+    return adler;
+}
+
 /* ////////////////////////////////////////////////////////////////////////// */
 /* / Zlib                                                                   / */
 /* ////////////////////////////////////////////////////////////////////////// */
@@ -2652,6 +3086,145 @@ unsigned lodepng_zlib_decompress(unsigned char** out, size_t* outsize,
     return error;
 }
 
+void lodepng_zlib_stream_init(LodePNGZlibStream* stream,
+                              const LodePNGDecompressSettings* settings) {
+    lodepng_memset(stream, 0, sizeof(*stream));
+    stream->settings = *settings;
+    stream->adler = 1u;
+}
+
+void lodepng_zlib_stream_cleanup(LodePNGZlibStream* stream) {
+    lodepng_free(stream->in);
+    lodepng_free(stream->out);
+    stream->in = stream->out = 0;
+    stream->insize = stream->inallocsize = stream->bp = 0;
+    stream->outsize = stream->outallocsize = stream->outpos = 0;
+}
+
+unsigned lodepng_zlib_stream_feed(LodePNGZlibStream* stream,
+                                  const unsigned char* in, size_t insize) {
+    const size_t used = stream->bp >> 3u;
+    size_t i;
+    ucvector v;
+
+    /*drop the input that is decoded, keeping the bit position in its byte*/
+    if (used != 0) {
+        for (i = used; i != stream->insize; ++i)
+            stream->in[i - used] = stream->in[i];
+        stream->insize -= used;
+        stream->bp &= 7u;
+    }
+
+    v = ucvector_init(stream->in, stream->insize);
+    v.allocsize = stream->inallocsize;
+    if (!ucvector_reserve(&v, stream->insize + insize))
+        return 83; /*alloc fail*/
+    stream->in = v.data;
+    stream->inallocsize = v.allocsize;
+    if (insize)
+        lodepng_memcpy(stream->in + stream->insize, in, insize);
+    stream->insize += insize;
+    return 0;
+}
+
+unsigned lodepng_zlib_stream_inflate(LodePNGZlibStream* stream,
+                                     unsigned last) {
+    LodePNGBitReader reader;
+    ucvector out;
+    size_t start, drop, i;
+    unsigned error, BFINAL, BTYPE;
+
+    stream->starved = 0;
+    if (stream->done)
+        return 0;
+
+    if (stream->stage == 0) {
+        /*the same header checks as lodepng_zlib_decompressv*/
+        const unsigned char* in = stream->in;
+        if (stream->insize < 2) {
+            stream->starved = !last;
+            return last ? 53 : 0; /*error, size of zlib data too small*/
+        }
+        if ((in[0] * 256 + in[1]) % 31 != 0)
+            return 24;
+        if ((in[0] & 15) != 8 || ((in[0] >> 4) & 15) > 7)
+            return 25;
+        if (((in[1] >> 5) & 1) != 0)
+            return 26;
+        stream->bp = 16;
+        stream->stage = 1;
+        return 0;
+    }
+
+    if (stream->stage == 2) {
+        /*the adler32 starts at the byte after the last block*/
+        const size_t pos = (stream->bp + 7u) >> 3u;
+        if (pos + 4 > stream->insize) {
+            stream->starved = !last;
+            return last ? 53 : 0;
+        }
+        if (!stream->settings.ignore_adler32 &&
+            lodepng_read32bitInt(&stream->in[pos]) != stream->adler)
+            return 58; /*error, adler checksum not correct*/
+        stream->bp = (pos + 4) << 3u;
+        stream->done = 1;
+        return 0;
+    }
+
+    /*keep the output not taken yet and the window before it, moving it only
+    once as much again can go, so each byte is moved about once*/
+    drop = stream->outsize > 32768u ? stream->outsize - 32768u : 0;
+    drop = LODEPNG_MIN(drop, stream->outpos);
+    if (drop >= 32768u) {
+        for (i = drop; i != stream->outsize; ++i)
+            stream->out[i - drop] = stream->out[i];
+        stream->outsize -= drop;
+        stream->outpos -= drop;
+    }
+
+    error = LodePNGBitReader_init(&reader, stream->in, stream->insize);
+    if (error)
+        return error;
+    reader.bp = stream->bp;
+    if (reader.bitsize - reader.bp < 3) {
+        stream->starved = !last;
+        return last ? 52 : 0; /*error, bit pointer will jump past memory*/
+    }
+
+    out = ucvector_init(stream->out, stream->outsize);
+    out.allocsize = stream->outallocsize;
+    start = out.size;
+    ensureBits9(&reader, 3);
+    BFINAL = readBits(&reader, 1);
+    BTYPE = readBits(&reader, 2);
+    if (BTYPE == 3)
+        error = 20; /*error: invalid BTYPE*/
+    else if (BTYPE == 0)
+        error = inflateNoCompression(&out, &reader, &stream->settings);
+    else
+        error = inflateHuffmanBlock(&out, &reader, BTYPE, 0);
+    stream->out = out.data;
+    stream->outallocsize = out.allocsize;
+
+    if (error) {
+        /*a block cut off by the end of the input fails like a corrupt one:
+        drop what it wrote, and give the error only once all input is there*/
+        if (!last && error != 83) {
+            stream->starved = 1;
+            error = 0;
+        }
+        return error;
+    }
+
+    stream->adler = lodepng_update_adler32(stream->adler, out.data + start,
+                                           out.size - start);
+    stream->outsize = out.size;
+    stream->bp = reader.bp;
+    if (BFINAL)
+        stream->stage = 2;
+    return 0;
+}
+
 /*expected_size is expected output size, to avoid intermediate allocations. Set
  * to 0 if not known. */
 static unsigned zlib_decompress(unsigned char** out, size_t* outsize,
@@ -3264,9 +3837,10 @@ static const unsigned lodepng_crc32_table7[256] = {
     0x264b06e6u};
 
 /* Computes the cyclic redundancy check as used by PNG chunks*/
-unsigned lodepng_crc32(const unsigned char* data, size_t length) {
+unsigned lodepng_update_crc32(unsigned crc, const unsigned char* data,
+                              size_t length) {
     /*Using the Slicing by Eight algorithm*/
-    unsigned r = 0xffffffffu;
+    unsigned r = crc ^ 0xffffffffu;
     while (length >= 8) {
         r = lodepng_crc32_table7[(data[0] ^ (r & 0xffu))] ^
             lodepng_crc32_table6[(data[1] ^ ((r >> 8) & 0xffu))] ^
@@ -3282,6 +3856,10 @@ unsigned lodepng_crc32(const unsigned char* data, size_t length) {
     }
     return r ^ 0xffffffffu;
 }
+
+unsigned lodepng_crc32(const unsigned char* data, size_t length) {
+    return lodepng_update_crc32(0u, data, length);
+}
 #    else  /* LODEPNG_COMPILE_CRC */
 /*in this case, the function is only declared here, and must be defined
 externally so that it will be linked in.
@@ -5322,6 +5900,170 @@ unsigned lodepng_inspect(unsigned* w, unsigned* h, LodePNGState* state,
     return state->error;
 }
 
+#        ifdef LODEPNG_COMPILE_SIMD
+/*
+SIMD versions of the PNG unfilters, modeled on the SSE2 code of libpng. Up is
+independent per byte and handles 16 (SSE2) or 32 (AVX2) bytes per step for any
+pixel size. Sub, Average and Paeth depend on the pixel to the left, so they
+handle one 3 or 4 byte pixel per step, with all channels of the pixel at once.
+Every path produces exactly the same bytes as the portable code.
+*/
+static __m128i simdLoad4(const unsigned char* p) {
+    int v;
+    memcpy(&v, p, 4);
+    return _mm_cvtsi32_si128(v);
+}
+
+static void simdStore4(unsigned char* p, __m128i v) {
+    const int x = _mm_cvtsi128_si32(v);
+    memcpy(p, &x, 4);
+}
+
+static __m128i simdLoad3(const unsigned char* p) {
+    int v = 0;
+    memcpy(&v, p, 3);
+    return _mm_cvtsi32_si128(v);
+}
+
+static void simdStore3(unsigned char* p, __m128i v) {
+    const int x = _mm_cvtsi128_si32(v);
+    memcpy(p, &x, 3);
+}
+
+static void unfilterUpSse2(unsigned char* recon, const unsigned char* scanline,
+                           const unsigned char* precon, size_t length) {
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16) {
+        const __m128i x = _mm_loadu_si128((const __m128i*)(scanline + i));
+        const __m128i b = _mm_loadu_si128((const __m128i*)(precon + i));
+        _mm_storeu_si128((__m128i*)(recon + i), _mm_add_epi8(x, b));
+    }
+    for (; i != length; ++i)
+        recon[i] = scanline[i] + precon[i];
+}
+
+#            ifdef LODEPNG_COMPILE_AVX2
+__attribute__((target("avx2"))) static void
+unfilterUpAvx2(unsigned char* recon, const unsigned char* scanline,
+               const unsigned char* precon, size_t length) {
+    size_t i = 0;
+    for (; i + 32 <= length; i += 32) {
+        const __m256i x = _mm256_loadu_si256((const __m256i*)(scanline + i));
+        const __m256i b = _mm256_loadu_si256((const __m256i*)(precon + i));
+        _mm256_storeu_si256((__m256i*)(recon + i), _mm256_add_epi8(x, b));
+    }
+    unfilterUpSse2(recon + i, scanline + i, precon + i, length - i);
+}
+
+static int cpuHasAvx2(void) {
+    static int cached = -1;
+    if (cached < 0)
+        cached = __builtin_cpu_supports("avx2") ? 1 : 0;
+    return cached;
+}
+#            endif /* LODEPNG_COMPILE_AVX2 */
+
+/*one pixel of bytewidth 3 or 4 at a time; the tail of the row is never read*/
+#            define SIMD_PIXEL_LOOP(body)                                      \
+                if (bytewidth == 4) {                                          \
+                    for (i = 0; i + 4 <= length; i += 4) {                     \
+                        const __m128i x = simdLoad4(scanline + i);             \
+                        const __m128i b =                                      \
+                            precon ? simdLoad4(precon + i) : zero;             \
+                        body;                                                  \
+                        simdStore4(recon + i, a);                              \
+                    }                                                          \
+                } else {                                                       \
+                    /*whole words except for the last pixel; the 4th lane */  \
+                    /*is garbage that never reaches a stored byte */           \
+                    const size_t wide = inPlace ? 0 : length - 3;              \
+                    for (i = 0; i + 4 <= length; i += 3) {                     \
+                        const __m128i x = simdLoad4(scanline + i);             \
+                        const __m128i b =                                      \
+                            precon ? simdLoad4(precon + i) : zero;             \
+                        body;                                                  \
+                        if (i < wide)                                          \
+                            simdStore4(recon + i, a);                          \
+                        else                                                   \
+                            simdStore3(recon + i, a);                          \
+                    }                                                          \
+                    {                                                          \
+                        const __m128i x = simdLoad3(scanline + i);             \
+                        const __m128i b =                                      \
+                            precon ? simdLoad3(precon + i) : zero;             \
+                        body;                                                  \
+                        simdStore3(recon + i, a);                              \
+                    }                                                          \
+                }
+
+/*returns 1 if the scanline was unfiltered, 0 to use the portable code*/
+static int unfilterScanlineSimd(unsigned char* recon,
+                                const unsigned char* scanline,
+                                const unsigned char* precon, size_t bytewidth,
+                                unsigned char filterType, size_t length) {
+    const __m128i zero = _mm_setzero_si128();
+    const int inPlace = recon == scanline; /*then never write ahead of i*/
+    size_t i;
+    if (filterType == 2) {
+        if (!precon)
+            return 0;
+#            ifdef LODEPNG_COMPILE_AVX2
+        if (cpuHasAvx2()) {
+            unfilterUpAvx2(recon, scanline, precon, length);
+            return 1;
+        }
+#            endif
+        unfilterUpSse2(recon, scanline, precon, length);
+        return 1;
+    }
+    if ((bytewidth != 3 && bytewidth != 4) || length % bytewidth != 0)
+        return 0;
+
+    if (filterType == 1) {
+        __m128i a = zero;
+        (void)precon;
+        SIMD_PIXEL_LOOP(a = _mm_add_epi8(a, x); (void)b)
+        return 1;
+    }
+    if (filterType == 3) {
+        /*floor((a + b) / 2): _mm_avg_epu8 rounds up, so drop the carried bit*/
+        const __m128i one = _mm_set1_epi8(1);
+        __m128i a = zero;
+        SIMD_PIXEL_LOOP(
+            const __m128i avg = _mm_sub_epi8(
+                _mm_avg_epu8(a, b), _mm_and_si128(_mm_xor_si128(a, b), one));
+            a = _mm_add_epi8(x, avg))
+        return 1;
+    }
+    if (filterType == 4) {
+        /*a, b and c widened to 16 bits, pa = |b - c|, pb = |a - c|,
+        pc = |a + b - 2c|; ties prefer a, then b, as in paethPredictor*/
+        __m128i a = zero, left = zero, c = zero, previous = zero;
+        SIMD_PIXEL_LOOP(
+            const __m128i bw = _mm_unpacklo_epi8(b, zero);
+            c = previous; previous = bw;
+            const __m128i pa0 = _mm_sub_epi16(bw, c);
+            const __m128i pb0 = _mm_sub_epi16(left, c);
+            const __m128i pc0 = _mm_add_epi16(pa0, pb0);
+            const __m128i pa = _mm_max_epi16(pa0, _mm_sub_epi16(zero, pa0));
+            const __m128i pb = _mm_max_epi16(pb0, _mm_sub_epi16(zero, pb0));
+            const __m128i pc = _mm_max_epi16(pc0, _mm_sub_epi16(zero, pc0));
+            const __m128i smallest = _mm_min_epi16(pc, _mm_min_epi16(pa, pb));
+            const __m128i useA = _mm_cmpeq_epi16(smallest, pa);
+            const __m128i useB = _mm_cmpeq_epi16(smallest, pb);
+            const __m128i bOrC = _mm_or_si128(_mm_and_si128(useB, bw),
+                                              _mm_andnot_si128(useB, c));
+            const __m128i nearest = _mm_or_si128(
+                _mm_and_si128(useA, left), _mm_andnot_si128(useA, bOrC));
+            left = _mm_add_epi8(_mm_unpacklo_epi8(x, zero), nearest);
+            a = _mm_packus_epi16(left, left))
+        return 1;
+    }
+    return 0;
+}
+#            undef SIMD_PIXEL_LOOP
+#        endif /* LODEPNG_COMPILE_SIMD */
+
 static unsigned unfilterScanline(unsigned char* recon,
                                  const unsigned char* scanline,
                                  const unsigned char* precon, size_t bytewidth,
@@ -5337,6 +6079,11 @@ static unsigned unfilterScanline(unsigned char* recon,
   */
 
     size_t i;
+#        ifdef LODEPNG_COMPILE_SIMD
+    if (filterType != 0 && unfilterScanlineSimd(recon, scanline, precon,
+                                                bytewidth, filterType, length))
+        return 0;
+#        endif
     switch (filterType) {
     case 0:
         for (i = 0; i != length; ++i)
@@ -5601,6 +6348,15 @@ static unsigned unfilterScanline(unsigned char* recon,
     return 0;
 }
 
+unsigned lodepng_unfilter_scanline(unsigned char* recon,
+                                   const unsigned char* scanline,
+                                   const unsigned char* precon,
+                                   size_t bytewidth, unsigned char filterType,
+                                   size_t length) {
+    return unfilterScanline(recon, scanline, precon, bytewidth, filterType,
+                            length);
+}
+
 static unsigned unfilter(unsigned char* out, const unsigned char* in,
                          unsigned w, unsigned h, unsigned bpp) {
     /*
@@ -1027,6 +1027,20 @@ information is placed in the info_png field of the LodePNGState.
 */
 unsigned lodepng_inspect(unsigned* w, unsigned* h, LodePNGState* state,
                          const unsigned char* in, size_t insize);
+
+/*
+Reverse the PNG filter of one scanline, for decoding rows one at a time.
+scanline excludes the filter type byte, which is given in filterType. precon
+is the previous unfiltered scanline, or NULL for the first one. recon and
+scanline may be the same memory, precon must be disjoint. bytewidth is the
+bytes per pixel rounded up to 1, length the bytes of the line. Returns error
+36 for an invalid filter type.
+*/
+unsigned lodepng_unfilter_scanline(unsigned char* recon,
+                                   const unsigned char* scanline,
+                                   const unsigned char* precon,
+                                   size_t bytewidth, unsigned char filterType,
+                                   size_t length);
 #        endif /*LODEPNG_COMPILE_DECODER*/
 
 /*
@@ -1159,6 +1173,11 @@ unsigned lodepng_chunk_create(unsigned char** out, size_t* outsize,
 
 /*Calculate CRC32 of buffer*/
 unsigned lodepng_crc32(const unsigned char* buf, size_t len);
+
+/*Continue a CRC32 (start value 0) with the bytes buf[0..len-1], for data read
+ * in pieces. Only available if LODEPNG_COMPILE_CRC is defined.*/
+unsigned lodepng_update_crc32(unsigned crc, const unsigned char* buf,
+                              size_t len);
 #    endif /*LODEPNG_COMPILE_PNG*/
 
 #    ifdef LODEPNG_COMPILE_ZLIB
@@ -1184,6 +1203,46 @@ buffer and *outsize its size in bytes. out must be freed by user after usage.
 unsigned lodepng_zlib_decompress(unsigned char** out, size_t* outsize,
                                  const unsigned char* in, size_t insize,
                                  const LodePNGDecompressSettings* settings);
+
+/*
+A zlib stream decompressed one deflate block at a time, for data too large to
+hold at once. Add input with lodepng_zlib_stream_feed and decode the next
+block with lodepng_zlib_stream_inflate. The output not taken yet is
+out[outpos..outsize-1]: advance outpos past what was used. Only that output and
+the 32 KiB window before it are kept. The other fields are private.
+*/
+typedef struct LodePNGZlibStream {
+    LodePNGDecompressSettings settings;
+    unsigned char* in; /*input, decoded up to bit bp*/
+    size_t insize;
+    size_t inallocsize;
+    size_t bp;
+    unsigned char* out; /*window and output not taken yet*/
+    size_t outsize;
+    size_t outallocsize;
+    size_t outpos;
+    unsigned adler;   /*adler32 of the output so far*/
+    unsigned stage;   /*0: zlib header, 1: blocks, 2: adler32 of the stream*/
+    unsigned done;    /*1 once the whole stream is decoded and checked*/
+    unsigned starved; /*1 if the last inflate call needs more input*/
+} LodePNGZlibStream;
+
+void lodepng_zlib_stream_init(LodePNGZlibStream* stream,
+                              const LodePNGDecompressSettings* settings);
+void lodepng_zlib_stream_cleanup(LodePNGZlibStream* stream);
+
+/*Appends input to the stream. Returns error 83 if out of memory.*/
+unsigned lodepng_zlib_stream_feed(LodePNGZlibStream* stream,
+                                  const unsigned char* in, size_t insize);
+
+/*
+Decodes the zlib header, the next deflate block or the final adler32. If the
+input ends before that and last is 0, nothing is decoded and starved is set:
+feed more input and call again. Set last once all input is fed, so a stream
+cut short gives its error. Returns an error code, 0 if ok.
+*/
+unsigned lodepng_zlib_stream_inflate(LodePNGZlibStream* stream,
+                                     unsigned last);
 #        endif /*LODEPNG_COMPILE_DECODER*/
 
 #        ifdef LODEPNG_COMPILE_ENCODER
@@ -1198,6 +1257,11 @@ unsigned lodepng_zlib_compress(unsigned char** out, size_t* outsize,
                                const unsigned char* in, size_t insize,
                                const LodePNGCompressSettings* settings);
 
+/*Update the running adler32 checksum (start value 1) of a zlib stream with the
+ * bytes data[0..len-1].*/
+unsigned lodepng_update_adler32(unsigned adler, const unsigned char* data,
+                                size_t len);
+
 /*
 Find length-limited Huffman code for given frequencies. This function is in the
 public interface only for tests, it's used internally by lodepng_deflate.
@@ -1212,6 +1276,22 @@ unsigned lodepng_deflate(unsigned char** out, size_t* outsize,
                          const unsigned char* in, size_t insize,
                          const LodePNGCompressSettings* settings);
 
+/*
+Compress one chunk of a larger deflate stream, for streaming and parallel
+compression. in[0..dictsize-1] is data that precedes the chunk in the
+stream: it is not output, but matches may refer to it (at most the last
+windowsize bytes are used). in[dictsize..insize-1] is compressed. If final is
+0, the output ends with an empty stored block (a "sync flush") so it ends on a
+byte boundary and the next chunk's output can simply be appended. The last
+chunk of the stream must have final set to 1. btype must be 1 or 2. The output
+is appended to *out like in lodepng_deflate.
+*/
+unsigned lodepng_deflate_chunk(unsigned char** out, size_t* outsize,
+                               const unsigned char* in, size_t dictsize,
+                               size_t insize,
+                               const LodePNGCompressSettings* settings,
+                               unsigned final);
+
 #        endif /*LODEPNG_COMPILE_ENCODER*/
 #    endif     /*LODEPNG_COMPILE_ZLIB*/
 